@@ -0,0 +1,366 @@
+#define SIMPLE2D_NO_GLFW
+#include "Tools.h"
+#include "FrameSync.h"
+#include "Scene.h"
+#include <algorithm>
+#include <sstream>
+#include <string>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+//-----------------Benchmark----------------------
+//headless跑一组参数化场景：实例数（1k~10M）× 静态/动态 × 合成大batch/很多小batch，
+//每个场景先热身再计时，结果输出成JSON，方便不同提交之间对比回归
+//没有GPU的机器上用软件驱动（lavapipe），例如：VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json
+
+#ifndef SIMPLE2D_COMMIT
+#define SIMPLE2D_COMMIT "unknown"   // CMake配置时填入git提交号
+#endif
+
+const uint32_t BENCH_WIDTH = 800;
+const uint32_t BENCH_HEIGHT = 800;
+const uint32_t SMALL_BATCH = 256;   // "很多小batch"场景每次draw最多的实例数
+
+struct BenchOptions {
+    uint32_t framesInFlight = 2;        // --frames-in-flight N
+    uint32_t warmupFrames = 10;         // --warmup N
+    uint32_t frames = 100;              // --frames N（每个场景计时的帧数）
+    uint32_t maxInstances = 10000000;   // --max-instances N（跳过实例数更多的场景）
+    std::string filter;                 // --case TEXT（只跑名字里包含TEXT的场景）
+    std::string jsonPath = "benchmark.json"; // --json PATH
+    bool gpuCull = true;                // --no-gpu-cull
+    uint32_t recordThreads = 0;         // --record-threads N
+    bool help = false;                  // --help
+};
+
+const char* BENCH_USAGE =
+    "usage: Simple2DBenchmark [--frames-in-flight N] [--warmup N] [--frames N] [--max-instances N]\n"
+    "                         [--case TEXT] [--json PATH] [--no-gpu-cull] [--record-threads N]\n";
+
+//非负整数参数；不是数字（或后面还有别的字符）时抛异常
+uint32_t ParseUintArg(const std::string& name, const std::string& value)
+{
+    size_t used = 0;
+    unsigned long v = 0;
+    try {
+        if (!value.empty() && value[0] != '-') v = std::stoul(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || v > UINT32_MAX) throw std::runtime_error("invalid value for " + name + ": " + value);
+    return (uint32_t)v;
+}
+
+BenchOptions ParseBenchOptions(int argc, char** argv)
+{
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--frames-in-flight" && i + 1 < argc) opt.framesInFlight = std::max(ParseUintArg(arg, argv[++i]), 1u);
+        else if (arg == "--warmup" && i + 1 < argc) opt.warmupFrames = ParseUintArg(arg, argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) opt.frames = std::max(ParseUintArg(arg, argv[++i]), 1u);
+        else if (arg == "--max-instances" && i + 1 < argc) opt.maxInstances = ParseUintArg(arg, argv[++i]);
+        else if (arg == "--case" && i + 1 < argc) opt.filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) opt.jsonPath = argv[++i];
+        else if (arg == "--no-gpu-cull") opt.gpuCull = false;
+        else if (arg == "--record-threads" && i + 1 < argc) opt.recordThreads = ParseUintArg(arg, argv[++i]);
+        else if (arg == "--help" || arg == "-h") opt.help = true;
+        else throw std::runtime_error("unknown argument: " + arg);
+    }
+    return opt;
+}
+
+struct BenchCase {
+    std::string name;
+    uint32_t instances = 0;
+    bool dynamic = true;                // 动态：每帧重新生成、排序并写入全部实例；静态：只在前framesInFlight帧写入
+    uint32_t maxBatch = UINT32_MAX;     // UINT32_MAX表示尽量合成大batch
+};
+
+std::vector<BenchCase> MakeBenchCases(const BenchOptions& opt)
+{
+    std::vector<BenchCase> cases;
+    for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u, 10000000u }) {
+        if (count > opt.maxInstances) continue;
+        for (bool dynamic : { false, true }) {
+            for (uint32_t maxBatch : { UINT32_MAX, SMALL_BATCH }) {
+                BenchCase c;
+                c.instances = count;
+                c.dynamic = dynamic;
+                c.maxBatch = maxBatch;
+                c.name = std::string(dynamic ? "dynamic" : "static") + "/" + (maxBatch == UINT32_MAX ? "merged" : "small") + "/" + std::to_string(count);
+                if (opt.filter.empty() || c.name.find(opt.filter) != std::string::npos) cases.push_back(c);
+            }
+        }
+    }
+    return cases;
+}
+
+struct BenchResult {
+    BenchCase params;
+    std::string error;                  // 不为空表示这个场景失败（例如显存不够）
+    uint32_t frames = 0;
+    uint32_t drawCalls = 0;
+    double frameMeanMs = 0.0, frameP50Ms = 0.0, frameP99Ms = 0.0, frameMaxMs = 0.0;
+    double buildMs = 0.0;               // 每帧平均：生成精灵、排序、写实例
+    double recordMs = 0.0;              // 每帧平均：录制command buffer
+    double submitMs = 0.0;              // 每帧平均：vkQueueSubmit
+    double gpuPassP50Ms = 0.0;          // render pass的GPU时间（时间戳）
+    uint64_t uploadBytesPerFrame = 0;   // 平均每帧写进实例环形缓冲的字节数
+    double uploadMBps = 0.0;            // 写实例数据时的带宽（只算拷贝，不算排序）
+    uint64_t gpuBytesUsed = 0, gpuBytesReserved = 0;
+    uint64_t residentBytes = 0;         // 进程常驻内存（只在Linux上统计）
+};
+
+//各场景共用的设备资源
+struct BenchContext {
+    const vk::UniqueDevice& device;
+    vk::PhysicalDevice physicalDevice;
+    vk::Queue queue;
+    uint32_t queueFamily;
+    const vk::UniqueRenderPass& renderPass;
+    const std::vector<OffscreenTarget>& targets;
+    GpuAllocator& allocator;
+    const Scene& scene;
+};
+
+//出错退出场景时，先等GPU用完，再销毁场景里的资源（声明在所有GPU资源之后，最先析构）
+struct DeviceIdleGuard {
+    vk::Device device;
+    ~DeviceIdleGuard()
+    {
+        try { device.waitIdle(); }
+        catch (...) {}
+    }
+};
+
+double Percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    size_t index = std::min((size_t)(p * (samples.size() - 1) + 0.5), samples.size() - 1);
+    return samples[index];
+}
+
+uint64_t ResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+BenchResult RunCase(const BenchCase& params, const BenchOptions& opt, BenchContext& ctx)
+{
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    BenchResult result;
+    result.params = params;
+    uint32_t framesInFlight = opt.framesInFlight;
+    vk::Extent2D extent(BENCH_WIDTH, BENCH_HEIGHT);
+
+    InstanceRing<InstanceData> instances(ctx.device, ctx.allocator, framesInFlight, params.instances, vk::BufferUsageFlagBits::eStorageBuffer);
+    SpriteBatch batch;
+    batch.setMaxBatchSize(params.maxBatch);
+    std::unique_ptr<GpuCuller> culler;
+    if (opt.gpuCull)
+        culler = std::make_unique<GpuCuller>(ctx.device, ctx.physicalDevice, ctx.allocator, framesInFlight, *ctx.scene.shaders, "Shader/cull.comp", (uint32_t)indices.size(),
+            std::array<float, 2>{ 0.1f, 0.1f }, ctx.scene.pipelines->pipelineCache());
+    std::unique_ptr<JobSystem> jobs;
+    std::unique_ptr<ParallelRecorder> recorder;
+    if (opt.recordThreads > 0) {
+        jobs = std::make_unique<JobSystem>(opt.recordThreads - 1);
+        recorder = std::make_unique<ParallelRecorder>(ctx.device, ctx.queueFamily, framesInFlight, *jobs);
+    }
+    GpuProfiler gpuProfiler(ctx.device, ctx.physicalDevice, ctx.queueFamily, framesInFlight);
+    auto commandPool = ctx.device->createCommandPoolUnique({ vk::CommandPoolCreateFlagBits::eResetCommandBuffer, ctx.queueFamily });
+    std::vector<vk::UniqueCommandBuffer> commandBuffers =
+        ctx.device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, framesInFlight });
+    FrameSync sync = InitFrameSync(ctx.device, framesInFlight, 0);
+    DeviceIdleGuard idle{ *ctx.device };
+
+    //静态场景：只生成、排序一次，CPU上留一份，前framesInFlight帧拷进环形缓冲的各段，之后不再写
+    std::vector<InstanceData> staticInstances;
+    if (!params.dynamic) {
+        batch.begin();
+        BuildSprites(batch, params.instances, 0.0f, 1.0f, {});
+        staticInstances.resize(batch.size());
+        batch.end(staticInstances.data());
+    }
+    size_t instanceBytes = sizeof(InstanceData) * (size_t)params.instances;
+
+    std::vector<double> frameTimes;
+    double buildMs = 0.0, recordMs = 0.0, submitMs = 0.0, writeMs = 0.0;
+    uint64_t uploadBytes = 0;
+    auto startTime = Clock::now();
+    uint32_t totalFrames = opt.warmupFrames + opt.frames;
+    for (uint32_t frameIndex = 0; frameIndex < totalFrames; ++frameIndex) {
+        bool measured = frameIndex >= opt.warmupFrames;
+        auto frameStart = Clock::now();
+        WaitForFrame(ctx.device, sync);
+        uint32_t frame = sync.currentFrame;
+        ctx.device->resetFences(*sync.inFlightFences[frame]);
+
+        auto buildStart = Clock::now();
+        double frameWriteMs = 0.0;
+        uint64_t frameBytes = 0;
+        if (params.dynamic) {
+            float time = std::chrono::duration<float>(Clock::now() - startTime).count();
+            batch.begin();
+            BuildSprites(batch, params.instances, time, 1.0f, {});
+            auto endStart = Clock::now();
+            batch.end(instances.begin(frame, batch.size()));
+            frameWriteMs = ms(endStart, Clock::now()) - batch.stats().sortMs;
+            frameBytes = instanceBytes;
+        }
+        else {
+            InstanceData* dst = instances.begin(frame, (uint32_t)staticInstances.size());
+            if (frameIndex < framesInFlight) {
+                auto copyStart = Clock::now();
+                memcpy(dst, staticInstances.data(), instanceBytes);
+                frameWriteMs = ms(copyStart, Clock::now());
+                frameBytes = instanceBytes;
+            }
+        }
+        auto recordStart = Clock::now();
+
+        auto& cmd = commandBuffers[frame];
+        cmd->reset();
+        RecordCommandBuffer(*cmd, ctx.renderPass, ctx.targets[frame].framebuffer, extent, ctx.scene, instances, batch, nullptr, culler.get(), recorder.get(),
+            &gpuProfiler, frame);
+        auto submitStart = Clock::now();
+
+        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *cmd };
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.setCommandBuffers(commandBuffersToSubmit);
+        ctx.queue.submit(submitInfo, *sync.inFlightFences[frame]);
+        gpuProfiler.submitted(frame);
+        auto frameEnd = Clock::now();
+        AdvanceFrame(sync);
+
+        //静态场景的写入只发生在热身阶段，上传统计从第0帧开始算
+        writeMs += frameWriteMs;
+        uploadBytes += frameBytes;
+        if (!measured) continue;
+        frameTimes.push_back(ms(frameStart, frameEnd));
+        buildMs += ms(buildStart, recordStart);
+        recordMs += ms(recordStart, submitStart);
+        submitMs += ms(submitStart, frameEnd);
+    }
+    ctx.device->waitIdle();
+
+    result.frames = opt.frames;
+    result.drawCalls = (uint32_t)batch.draws().size();
+    for (double t : frameTimes) result.frameMeanMs += t;
+    result.frameMeanMs /= frameTimes.size();
+    result.frameP50Ms = Percentile(frameTimes, 0.5);
+    result.frameP99Ms = Percentile(frameTimes, 0.99);
+    result.frameMaxMs = *std::max_element(frameTimes.begin(), frameTimes.end());
+    result.buildMs = buildMs / opt.frames;
+    result.recordMs = recordMs / opt.frames;
+    result.submitMs = submitMs / opt.frames;
+    if (const LatencyHistogram* pass = gpuProfiler.zone("render pass")) result.gpuPassP50Ms = pass->percentile(0.5);
+    result.uploadBytesPerFrame = uploadBytes / totalFrames;
+    result.uploadMBps = writeMs > 0.0 ? uploadBytes / (writeMs / 1000.0) / (1024.0 * 1024.0) : 0.0;
+    AllocatorStats memory = ctx.allocator.stats();
+    result.gpuBytesUsed = memory.bytesUsed;
+    result.gpuBytesReserved = memory.bytesReserved;
+    result.residentBytes = ResidentBytes();
+    return result;
+}
+
+std::string WriteBenchJson(const BenchOptions& opt, const vk::PhysicalDeviceProperties& device, const std::vector<BenchResult>& results)
+{
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"commit\": " << JsonString(SIMPLE2D_COMMIT) << ",\n";
+    out << "  \"device\": " << JsonString(device.deviceName.data()) << ",\n";
+    out << "  \"driverVersion\": " << device.driverVersion << ",\n";
+    out << "  \"framesInFlight\": " << opt.framesInFlight << ",\n";
+    out << "  \"warmupFrames\": " << opt.warmupFrames << ",\n";
+    out << "  \"gpuCull\": " << (opt.gpuCull ? "true" : "false") << ",\n";
+    out << "  \"recordThreads\": " << opt.recordThreads << ",\n";
+    out << "  \"cases\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << JsonString(r.params.name)
+            << ", \"instances\": " << r.params.instances
+            << ", \"dynamic\": " << (r.params.dynamic ? "true" : "false")
+            << ", \"maxBatch\": " << (r.params.maxBatch == UINT32_MAX ? 0 : r.params.maxBatch);
+        if (!r.error.empty()) {
+            out << ", \"error\": " << JsonString(r.error) << "}";
+            continue;
+        }
+        out << ", \"frames\": " << r.frames
+            << ", \"drawCalls\": " << r.drawCalls
+            << ", \"frameMs\": {\"mean\": " << r.frameMeanMs << ", \"p50\": " << r.frameP50Ms << ", \"p99\": " << r.frameP99Ms << ", \"max\": " << r.frameMaxMs << "}"
+            << ", \"cpuMs\": {\"build\": " << r.buildMs << ", \"record\": " << r.recordMs << ", \"submit\": " << r.submitMs << "}"
+            << ", \"gpuPassP50Ms\": " << r.gpuPassP50Ms
+            << ", \"uploadBytesPerFrame\": " << r.uploadBytesPerFrame
+            << ", \"uploadMBps\": " << r.uploadMBps
+            << ", \"memory\": {\"gpuUsed\": " << r.gpuBytesUsed << ", \"gpuReserved\": " << r.gpuBytesReserved << ", \"resident\": " << r.residentBytes << "}}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions opt;
+    try {
+        opt = ParseBenchOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n" << BENCH_USAGE;
+        return 2;
+    }
+    if (opt.help) {
+        std::cout << BENCH_USAGE;
+        return 0;
+    }
+    std::vector<BenchCase> cases = MakeBenchCases(opt);
+    vk::SurfaceFormatKHR format(vk::Format::eR8G8B8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear);
+    vk::Extent2D extent(BENCH_WIDTH, BENCH_HEIGHT);
+
+    vk::UniqueInstance instance = InitHeadlessInstance();
+    vk::PhysicalDevice physicalDevice = instance->enumeratePhysicalDevices()[0];
+    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    std::optional<uint32_t> graphicsFamily = InitHeadlessGraphicFamily(physicalDevice);
+    vk::UniqueDevice device = InitDevice(graphicsFamily, physicalDevice, false);
+    vk::Queue queue = device->getQueue(graphicsFamily.value(), 0);
+    vk::UniqueRenderPass renderPass = InitRenderPass(format, device, vk::ImageLayout::eTransferSrcOptimal);
+    std::vector<OffscreenTarget> targets = InitOffscreenTargets(device, physicalDevice, renderPass, format.format, extent, opt.framesInFlight);
+
+    GpuAllocator allocator(device, physicalDevice);
+    StagingUploader uploader(device, allocator, queue, graphicsFamily.value());
+    //不读写磁盘上的pipeline缓存，每次运行的初始化条件相同
+    Scene scene = InitScene(device, physicalDevice, allocator, uploader, renderPass, 0, "");
+    BenchContext ctx{ device, physicalDevice, queue, graphicsFamily.value(), renderPass, targets, allocator, scene };
+
+    std::cout << "[bench] " << properties.deviceName.data() << ", " << cases.size() << " cases" << std::endl;
+    std::vector<BenchResult> results;
+    for (const BenchCase& c : cases) {
+        BenchResult r;
+        try {
+            r = RunCase(c, opt, ctx);
+            std::cout << "[bench] " << c.name << ": frame p50 " << r.frameP50Ms << " ms, p99 " << r.frameP99Ms << " ms" << std::endl;
+        }
+        catch (const std::exception& e) {
+            r.params = c;
+            r.error = e.what();
+            std::cout << "[bench] " << c.name << ": " << r.error << std::endl;
+        }
+        results.push_back(r);
+    }
+
+    //初始化过程会往stdout打日志，所以结果单独写文件
+    std::ofstream file(opt.jsonPath);
+    if (!file.is_open()) throw std::runtime_error("failed to open " + opt.jsonPath);
+    file << WriteBenchJson(opt, properties, results);
+    std::cout << "[bench] results written to " << opt.jsonPath << std::endl;
+    device->waitIdle();
+    return 0;
+}
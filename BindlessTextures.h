@@ -0,0 +1,135 @@
+#pragma once
+#include "Memory.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+
+//-----------------Bindless贴图数组----------------------
+//一个很大的 sampler2D 数组（descriptor indexing），每个实例自己带贴图下标，
+//用不同贴图的精灵也能留在同一次绘制里，整帧只绑定一次描述符集
+//数组是 PARTIALLY_BOUND + UPDATE_AFTER_BIND：没写的槽位不用填，新贴图可以在集合已被绑定时追加
+//【新增】贴图区域表：贴图下标 + UV范围放在一个storage buffer里，实例只带16位的区域下标（test.vert 里查表）
+//区域只追加、写进去就不再改，GPU还在读的帧不受影响
+
+//和 test.vert 的 Region 一致（std430下32字节）
+struct TextureRegion {
+    float uvRect[4];    // u0, v0, u1, v1
+    uint32_t texture;   // bindless贴图数组下标
+    uint32_t pad[3];
+};
+static_assert(sizeof(TextureRegion) == 32, "TextureRegion must match the std430 Region in test.vert");
+
+class BindlessTextures {
+public:
+    //构造时会把0号槽位填成1x1白图、0号区域指向整张白图（没有贴图的精灵用它），和其他上传一样需要 uploader.flush()
+    //区域下标在实例里只有16位，最多65536个
+    BindlessTextures(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        GpuAllocator& allocator,
+        StagingUploader& uploader,
+        uint32_t maxTextures = 4096,
+        uint32_t maxRegions = 65536)
+        : device(&device), allocator(&allocator), uploader(&uploader), regionCapacity(std::min(maxRegions, 65536u))
+    {
+        //上限不能超过驱动允许的 update-after-bind 贴图数量
+        auto props = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+        auto& indexing = props.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+        capacity = std::min({ maxTextures, indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+            indexing.maxPerStageDescriptorUpdateAfterBindSampledImages });
+
+        vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, capacity, vk::ShaderStageFlagBits::eFragment);
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound
+            | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eVariableDescriptorCount;
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo(1, &bindingFlags);
+        vk::DescriptorSetLayoutCreateInfo layoutInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, 1, &binding);
+        layoutInfo.pNext = &flagsInfo;
+        setLayout = device->createDescriptorSetLayoutUnique(layoutInfo);
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, capacity);
+        descriptorPool = device->createDescriptorPoolUnique({ vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, 1, &poolSize });
+        vk::DescriptorSetVariableDescriptorCountAllocateInfo countInfo(1, &capacity);
+        vk::DescriptorSetAllocateInfo allocInfo(*descriptorPool, 1, &*setLayout);
+        allocInfo.pNext = &countInfo;
+        descriptorSet = device->allocateDescriptorSets(allocInfo)[0];
+
+        //图集页的mip只生成到padding还剩1个texel的那一级（图片的级数就是上限），clamp + 三线性就够了
+        vk::SamplerCreateInfo samplerInfo({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
+            vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+            0.0f, VK_FALSE, 1.0f, VK_FALSE, vk::CompareOp::eAlways, 0.0f, VK_LOD_CLAMP_NONE);
+        sampler = device->createSamplerUnique(samplerInfo);
+
+        regions = createBuffer(device, allocator, sizeof(TextureRegion) * (size_t)regionCapacity,
+            vk::BufferUsageFlagBits::eStorageBuffer, MemoryUsage::CpuToGpu);
+
+        const uint32_t white = PackColor(255, 255, 255);
+        const float fullUV[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+        addRegion(add(1, 1, { { 1, 1, &white } }), fullUV);
+    }
+
+    //上传一张RGBA8贴图（mips[0]是原图），返回它在数组里的下标
+    uint32_t add(uint32_t width, uint32_t height, const std::vector<ImageMip>& mips)
+    {
+        if (textures.size() >= capacity) throw std::runtime_error("bindless texture array is full!");
+        GpuImage image = createImage(*device, *allocator, { width, height }, (uint32_t)mips.size(), vk::Format::eR8G8B8A8Unorm,
+            vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+        uploader->uploadImage(*image, mips);
+
+        uint32_t index = (uint32_t)textures.size();
+        vk::DescriptorImageInfo imageInfo(*sampler, *image.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::WriteDescriptorSet write(descriptorSet, 0, index, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+        (*device)->updateDescriptorSets(write, nullptr);
+        textures.push_back(std::move(image));
+        return index;
+    }
+
+    //登记一块贴图区域，返回区域下标（写进 TextureRef / 实例）
+    uint32_t addRegion(uint32_t texture, const float uv[4])
+    {
+        if (regionCount >= regionCapacity) throw std::runtime_error("texture region table is full!");
+        TextureRegion region = {};
+        memcpy(region.uvRect, uv, sizeof(region.uvRect));
+        region.texture = texture;
+        static_cast<TextureRegion*>(regions.mapped())[regionCount] = region;
+        return regionCount++;
+    }
+
+    //上传图集的所有页，返回每张小图对应的贴图引用（按图集里的图片编号排列）
+    std::vector<TextureRef> addAtlas(const TextureAtlasBuilder& atlas, uint32_t imageCount)
+    {
+        std::vector<uint32_t> pageTextures;
+        for (const AtlasPage& page : atlas.atlasPages()) {
+            std::vector<ImageMip> mips;
+            for (uint32_t level = 0, size = page.size; level < page.mips.size(); ++level, size = std::max(size / 2, 1u))
+                mips.push_back({ size, size, page.mips[level].data() });
+            pageTextures.push_back(add(page.size, page.size, mips));
+        }
+
+        std::vector<TextureRef> refs(imageCount);
+        for (uint32_t i = 0; i < imageCount; ++i) {
+            const AtlasRegion& region = atlas.region(i);
+            refs[i].region = addRegion(pageTextures[region.page], region.uv);
+        }
+        return refs;
+    }
+
+    vk::DescriptorSetLayout layout() const { return *setLayout; }
+    vk::DescriptorSet set() const { return descriptorSet; }
+    uint32_t count() const { return (uint32_t)textures.size(); }
+    uint32_t maxCount() const { return capacity; }
+    vk::Buffer regionBuffer() const { return *regions; }
+    vk::DeviceSize regionBufferSize() const { return regions.size; }
+
+private:
+    const vk::UniqueDevice* device;
+    GpuAllocator* allocator;
+    StagingUploader* uploader;
+    uint32_t capacity = 0;
+    vk::UniqueDescriptorSetLayout setLayout;
+    vk::UniqueDescriptorPool descriptorPool;
+    vk::DescriptorSet descriptorSet;
+    vk::UniqueSampler sampler;
+    std::vector<GpuImage> textures;
+    GpuBuffer regions;              // 贴图区域表（常驻映射）
+    uint32_t regionCapacity;
+    uint32_t regionCount = 0;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include "SpatialGrid.h"    // Bounds2D
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//-----------------脏矩形----------------------
+//变了的实例把自己的新旧包围盒标成脏矩形，每张swapchain图片各自累积"上次画它之后"的所有脏矩形，
+//画这张图片时只重画这些区域（其余像素还是它上次的内容）。没有新的脏矩形时主循环可以不画、阻塞等事件
+//矩形多了就合并：和已有的相交或相邻就并进去，超过 MaxRects 个时全部并成一个外接矩形
+
+//像素矩形，[x0, x1) × [y0, y1)
+struct DamageRect {
+    int32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    int64_t area() const { return (int64_t)(x1 - x0) * (y1 - y0); }
+    bool touches(const DamageRect& o) const { return x0 <= o.x1 && o.x0 <= x1 && y0 <= o.y1 && o.y0 <= y1; }
+    void merge(const DamageRect& o)
+    {
+        x0 = std::min(x0, o.x0); y0 = std::min(y0, o.y0);
+        x1 = std::max(x1, o.x1); y1 = std::max(y1, o.y1);
+    }
+};
+
+//take() 的结果
+struct DamageRegion {
+    std::vector<DamageRect> rects;
+    bool full = false;      // 整张图片都要重画（图片内容未知，不能从上次的结果接着画）
+};
+
+struct DamageStats {
+    uint32_t frames = 0;            // 画了多少帧
+    uint32_t fullFrames = 0;        // 其中整张重画的
+    double repaintedPixels = 0.0;   // 重画像素占所有帧全屏像素的比例（0~1）
+};
+
+class DamageTracker {
+public:
+    static constexpr uint32_t MaxRects = 8;
+    static constexpr int32_t Padding = 2;   // 脏矩形向外扩的像素（抗锯齿的过渡带、取整误差）
+
+    //swapchain（重新）创建：图片内容都未知，每张都要整张画一次
+    void reset(uint32_t imageCount, uint32_t width, uint32_t height)
+    {
+        this->width = (int32_t)width;
+        this->height = (int32_t)height;
+        images.assign(imageCount, {});
+        for (auto& image : images) image.full = true;
+        changed = true;
+    }
+
+    //NDC里的包围盒（Vulkan的NDC里y向下，和像素坐标同向）
+    void add(const Bounds2D& ndc)
+    {
+        DamageRect r;
+        r.x0 = std::max((int32_t)std::floor((ndc.minX * 0.5f + 0.5f) * width) - Padding, 0);
+        r.y0 = std::max((int32_t)std::floor((ndc.minY * 0.5f + 0.5f) * height) - Padding, 0);
+        r.x1 = std::min((int32_t)std::ceil((ndc.maxX * 0.5f + 0.5f) * width) + Padding, width);
+        r.y1 = std::min((int32_t)std::ceil((ndc.maxY * 0.5f + 0.5f) * height) + Padding, height);
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) return;
+        for (auto& image : images) {
+            if (!image.full) insert(image.rects, r);
+        }
+        changed = true;
+    }
+
+    void addAll()
+    {
+        for (auto& image : images) image.full = true;
+        changed = true;
+    }
+
+    //逐个比较上一帧和这一帧的实例：变了的把新旧包围盒都标脏，多出来和少掉的也一样
+    //boundsOf(const T&) 返回实例的NDC包围盒
+    template<typename T, typename Fn>
+    void diff(const std::vector<T>& previous, const std::vector<T>& current, Fn boundsOf)
+    {
+        size_t common = std::min(previous.size(), current.size());
+        for (size_t i = 0; i < common; ++i) {
+            if (memcmp(&previous[i], &current[i], sizeof(T)) == 0) continue;
+            add(boundsOf(previous[i]));
+            add(boundsOf(current[i]));
+        }
+        for (size_t i = common; i < previous.size(); ++i) add(boundsOf(previous[i]));
+        for (size_t i = common; i < current.size(); ++i) add(boundsOf(current[i]));
+    }
+
+    //上次画完之后有没有新的脏矩形（没有就不用画：屏幕上最后present的那张已经是最新的）
+    bool pending() const { return changed; }
+
+    //开始画第image张图片：取走它累积的脏矩形
+    DamageRegion take(uint32_t image)
+    {
+        ImageDamage& d = images[image];
+        DamageRegion region;
+        int64_t area = 0;
+        for (const DamageRect& r : d.rects) area += r.area();
+        //脏区超过半屏时整张重画，省得拆成很多次小拷贝和绘制
+        region.full = d.full || area * 2 > (int64_t)width * height;
+        if (region.full) region.rects = { { 0, 0, width, height } };
+        else region.rects = std::move(d.rects);
+
+        lastStats.frames++;
+        if (region.full) lastStats.fullFrames++;
+        lastStats.repaintedPixels += region.full ? (double)width * height : (double)area;
+
+        d = {};
+        changed = false;
+        return region;
+    }
+
+    //取出并清空统计（每秒一次）
+    DamageStats takeStats()
+    {
+        DamageStats s = lastStats;
+        if (s.frames) s.repaintedPixels /= (double)width * height * s.frames;
+        lastStats = {};
+        return s;
+    }
+
+private:
+    struct ImageDamage {
+        std::vector<DamageRect> rects;
+        bool full = false;
+    };
+
+    //并进已有的矩形；合并之后可能又碰到别的，继续合并
+    static void insert(std::vector<DamageRect>& rects, DamageRect r)
+    {
+        for (size_t i = 0; i < rects.size();) {
+            if (rects[i].touches(r)) {
+                r.merge(rects[i]);
+                rects[i] = rects.back();
+                rects.pop_back();
+                i = 0;
+            }
+            else {
+                ++i;
+            }
+        }
+        rects.push_back(r);
+        if (rects.size() > MaxRects) {
+            for (size_t i = 1; i < rects.size(); ++i) rects[0].merge(rects[i]);
+            rects.resize(1);
+        }
+    }
+
+    int32_t width = 0, height = 0;
+    std::vector<ImageDamage> images;
+    bool changed = true;
+    DamageStats lastStats;
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include "Tools.h"
+
+//-----------------Frames In Flight----------------------
+//多帧并行：CPU录制第N+1帧时，GPU还在执行第N帧，不再每帧waitIdle
+struct FrameSync {
+    uint32_t framesInFlight = 0;
+    uint32_t currentFrame = 0;                          // 当前使用第几套"每帧资源"
+    std::vector<vk::UniqueFence> inFlightFences;        // 每帧一个：GPU执行完该帧命令后signal
+    std::vector<vk::UniqueSemaphore> imageAvailable;    // 每帧一个：acquire拿到图片后signal
+    std::vector<vk::UniqueSemaphore> renderFinished;    // 每张图片一个：present等待它（按图片分配，避免present还没用完就被复用）
+    std::vector<vk::Fence> imagesInFlight;              // 每张图片当前被哪一帧的fence占用
+};
+
+//帧统计：记录CPU等待GPU的时间，用来对比不同framesInFlight下的吞吐
+struct FrameStats {
+    double lastWaitMs = 0.0;        // 上一帧CPU阻塞在fence上的时间
+    double lastFrameMs = 0.0;       // 上一帧总耗时
+    double accumWaitMs = 0.0;
+    double accumFrameMs = 0.0;
+    uint32_t accumFrames = 0;
+    std::chrono::steady_clock::time_point lastFrameTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastReportTime = std::chrono::steady_clock::now();
+};
+
+//创建同步对象：fence初始为signaled，第一次等待直接通过
+FrameSync InitFrameSync(
+    const vk::UniqueDevice& device,
+    uint32_t framesInFlight,
+    uint32_t imageCount)
+{
+    if (framesInFlight == 0) throw std::runtime_error("framesInFlight must be at least 1");
+
+    FrameSync sync;
+    sync.framesInFlight = framesInFlight;
+    for (uint32_t i = 0; i < framesInFlight; ++i) {
+        sync.inFlightFences.push_back(device->createFenceUnique(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled)));
+        sync.imageAvailable.push_back(device->createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+    }
+    for (uint32_t i = 0; i < imageCount; ++i)
+        sync.renderFinished.push_back(device->createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+    sync.imagesInFlight.assign(imageCount, nullptr);
+    return sync;
+}
+
+//等待当前帧的上一轮提交完成（此时这套每帧资源可以安全复用），返回CPU等待的毫秒数
+double WaitForFrame(const vk::UniqueDevice& device, const FrameSync& sync)
+{
+    auto start = std::chrono::steady_clock::now();
+    vk::Fence fence = *sync.inFlightFences[sync.currentFrame];
+    if (device->waitForFences(fence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+        throw std::runtime_error("failed to wait for frame fence!");
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//acquire到的图片可能还被更早的一帧占用（图片数与帧数不相等时），先等它，再把图片登记给当前帧
+double WaitForImage(const vk::UniqueDevice& device, FrameSync& sync, uint32_t imageIndex)
+{
+    double waitMs = 0.0;
+    vk::Fence imageFence = sync.imagesInFlight[imageIndex];
+    vk::Fence frameFence = *sync.inFlightFences[sync.currentFrame];
+    if (imageFence && imageFence != frameFence) {
+        auto start = std::chrono::steady_clock::now();
+        if (device->waitForFences(imageFence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+            throw std::runtime_error("failed to wait for image fence!");
+        waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    sync.imagesInFlight[imageIndex] = frameFence;
+    return waitMs;
+}
+
+//切换到下一套每帧资源
+void AdvanceFrame(FrameSync& sync)
+{
+    sync.currentFrame = (sync.currentFrame + 1) % sync.framesInFlight;
+}
+
+//累计一帧的数据，每隔一秒输出一次平均值
+void RecordFrameStats(FrameStats& stats, double waitMs, uint32_t framesInFlight)
+{
+    auto now = std::chrono::steady_clock::now();
+    stats.lastWaitMs = waitMs;
+    stats.lastFrameMs = std::chrono::duration<double, std::milli>(now - stats.lastFrameTime).count();
+    stats.lastFrameTime = now;
+    stats.accumWaitMs += stats.lastWaitMs;
+    stats.accumFrameMs += stats.lastFrameMs;
+    stats.accumFrames++;
+
+    if (now - stats.lastReportTime >= std::chrono::seconds(1)) {
+        double avgFrame = stats.accumFrameMs / stats.accumFrames;
+        std::cout << "[frames in flight: " << framesInFlight << "] "
+            << "frame " << avgFrame << " ms (" << (avgFrame > 0.0 ? 1000.0 / avgFrame : 0.0) << " fps), "
+            << "cpu wait " << stats.accumWaitMs / stats.accumFrames << " ms/frame, "
+            << "last wait " << stats.lastWaitMs << " ms" << std::endl;
+        stats.accumWaitMs = 0.0;
+        stats.accumFrameMs = 0.0;
+        stats.accumFrames = 0;
+        stats.lastReportTime = now;
+    }
+}
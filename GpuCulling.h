@@ -0,0 +1,205 @@
+#pragma once
+#include "Memory.h"
+#include "SpriteBatch.h"
+#include "ShaderLibrary.h"
+
+//-----------------GPU视锥剔除 + 间接绘制----------------------
+//compute pass 逐实例测试包围圆和2D视口是否相交，可见实例压缩进输出缓冲，
+//并由GPU自己填写 VkDrawIndexedIndirectCommand 的 instanceCount，CPU不再逐个判断可见性
+//输入只绑定本帧那一段实例；实例多到超过 maxStorageBufferRange 时这一帧不剔除，绘制退回直接drawIndexed
+
+//间接绘制命令 + 剔除计数，和 cull.comp 里的 DrawCommand 布局一致（32字节步长）
+struct CullDrawCommand {
+    vk::DrawIndexedIndirectCommand draw;
+    uint32_t culledCount;
+    uint32_t pad[2];
+};
+static_assert(sizeof(CullDrawCommand) == 32, "CullDrawCommand must match cull.comp");
+
+//push constant，和 cull.comp 的 Params 一致
+struct CullParams {
+    float viewRect[4];      // minX, minY, maxX, maxY
+    float quadHalf[2];
+    uint32_t srcFirst;
+    uint32_t dstFirst;
+    uint32_t count;
+    uint32_t drawIndex;
+};
+
+struct CullStats {
+    uint32_t visible = 0;
+    uint32_t culled = 0;
+};
+
+class GpuCuller {
+public:
+    GpuCuller(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        GpuAllocator& allocator,
+        uint32_t framesInFlight,
+        ShaderLibrary& shaders,
+        const std::string& shaderPath,
+        uint32_t indexCount,
+        const std::array<float, 2>& quadHalf,
+        vk::PipelineCache pipelineCache = {})
+        : device(&device), allocator(&allocator), indexCount(indexCount), quadHalf(quadHalf), frames(framesInFlight)
+    {
+        vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+        maxStorageRange = limits.maxStorageBufferRange;
+        storageOffsetAlignment = limits.minStorageBufferOffsetAlignment;
+        //描述符布局、push constant范围和工作组大小都来自shader反射：0输入实例，1输出实例，2间接命令
+        auto program = shaders.get(shaderPath);
+        const ShaderReflection& reflection = program->reflection;
+        if (reflection.stage != ShaderStageKind::Compute) throw std::runtime_error(shaderPath + " is not a compute shader");
+        if (reflection.pushConstantSize != sizeof(CullParams)) throw std::runtime_error(shaderPath + ": push constants do not match CullParams");
+        groupSize = reflection.localSize[0];
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = MakeSetLayoutBindings({ program.get() }, 0);
+        if (bindings.size() != 3) throw std::runtime_error(shaderPath + ": expected 3 storage buffers in set 0");
+        setLayout = device->createDescriptorSetLayoutUnique({ {}, bindings });
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 3 * framesInFlight);
+        descriptorPool = device->createDescriptorPoolUnique({ {}, framesInFlight, 1, &poolSize });
+        std::vector<vk::DescriptorSetLayout> layouts(framesInFlight, *setLayout);
+        auto sets = device->allocateDescriptorSets({ *descriptorPool, layouts });
+        for (uint32_t i = 0; i < framesInFlight; ++i) frames[i].descriptorSet = sets[i];
+
+        std::vector<vk::PushConstantRange> pushRanges = MakePushConstantRanges({ program.get() });
+        pipelineLayout = device->createPipelineLayoutUnique({ {}, 1, &*setLayout, (uint32_t)pushRanges.size(), pushRanges.data() });
+
+        shader = program->createModule(device);
+        vk::ComputePipelineCreateInfo pipelineInfo({}, { {}, vk::ShaderStageFlagBits::eCompute, *shader, "main" }, *pipelineLayout);
+        pipeline = std::move(device->createComputePipelineUnique(pipelineCache, pipelineInfo).value);
+    }
+
+    //录制剔除（必须在render pass之外）：src是实例环形缓冲，srcOffset是本帧那一段的起点（字节）
+    //返回false表示这一帧没有剔除（实例太多，绑定范围超出设备限制），绘制时 active(frame) 也是false
+    bool record(
+        vk::CommandBuffer cmd,
+        uint32_t frame,
+        vk::Buffer src,
+        vk::DeviceSize srcOffset,
+        const std::vector<SpriteDrawCmd>& draws,
+        const std::array<float, 4>& viewRect)
+    {
+        FrameResources& f = frames[frame];
+        f.drawCount = 0;
+        f.active = false;
+        uint32_t totalInstances = 0;
+        for (auto& d : draws) totalInstances = std::max(totalInstances, d.firstInstance + d.instanceCount);
+        if (draws.empty()) return false;
+        vk::DeviceSize range = sizeof(InstanceData) * (vk::DeviceSize)totalInstances;
+        if (range > maxStorageRange || srcOffset % storageOffsetAlignment != 0) {
+            if (!warned) std::cout << "[cull] " << totalInstances << " instances do not fit maxStorageBufferRange / offset alignment, gpu culling skipped" << std::endl;
+            warned = true;
+            return false;
+        }
+        ensureCapacity(f, totalInstances, (uint32_t)draws.size());
+        f.drawCount = (uint32_t)draws.size();
+        f.active = true;
+
+        //间接命令放在常驻映射内存里：本帧fence已等过，CPU直接写初值（instanceCount清零）
+        auto* commands = static_cast<CullDrawCommand*>(f.commands.mapped());
+        for (uint32_t i = 0; i < draws.size(); ++i) {
+            commands[i] = {};
+            commands[i].draw = vk::DrawIndexedIndirectCommand(indexCount, 0, 0, 0, draws[i].firstInstance);
+        }
+
+        std::array<vk::DescriptorBufferInfo, 3> infos = {
+            vk::DescriptorBufferInfo(src, srcOffset, range),
+            vk::DescriptorBufferInfo(*f.output, 0, range),
+            vk::DescriptorBufferInfo(*f.commands, 0, VK_WHOLE_SIZE)
+        };
+        std::array<vk::WriteDescriptorSet, 3> writes;
+        for (uint32_t i = 0; i < 3; ++i)
+            writes[i] = vk::WriteDescriptorSet(f.descriptorSet, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &infos[i]);
+        (*device)->updateDescriptorSets(writes, nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, f.descriptorSet, nullptr);
+        for (uint32_t i = 0; i < draws.size(); ++i) {
+            CullParams params = {
+                { viewRect[0], viewRect[1], viewRect[2], viewRect[3] },
+                { quadHalf[0], quadHalf[1] },
+                draws[i].firstInstance, draws[i].firstInstance, draws[i].instanceCount, i
+            };
+            cmd.pushConstants<CullParams>(*pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, params);
+            cmd.dispatch((draws[i].instanceCount + groupSize - 1) / groupSize, 1, 1);
+        }
+
+        //compute的写入 -> 间接命令读取、顶点输入读取、以及帧结束后CPU读回计数
+        vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eHostRead);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eHost,
+            {}, barrier, nullptr, nullptr);
+        return true;
+    }
+
+    //这一帧录制了剔除：绘制时用 output() 和 drawIndirect()
+    bool active(uint32_t frame) const { return frames[frame].active; }
+
+    //剔除后的实例（绑定到实例顶点缓冲槽位）
+    vk::Buffer output(uint32_t frame) const { return *frames[frame].output; }
+
+    //第i个合批的间接绘制（render pass内调用）
+    void drawIndirect(vk::CommandBuffer cmd, uint32_t frame, uint32_t drawIndex) const
+    {
+        cmd.drawIndexedIndirect(*frames[frame].commands, drawIndex * sizeof(CullDrawCommand), 1, sizeof(CullDrawCommand));
+    }
+
+    //读回计数：必须在该帧的fence signal之后调用（也就是下次复用这一帧之前）
+    CullStats readStats(uint32_t frame) const
+    {
+        CullStats stats;
+        const FrameResources& f = frames[frame];
+        if (!f.commands.mapped()) return stats;
+        auto* commands = static_cast<const CullDrawCommand*>(f.commands.mapped());
+        for (uint32_t i = 0; i < f.drawCount; ++i) {
+            stats.visible += commands[i].draw.instanceCount;
+            stats.culled += commands[i].culledCount;
+        }
+        return stats;
+    }
+
+private:
+    struct FrameResources {
+        GpuBuffer output;               // 压缩后的实例（GPU写、GPU读）
+        GpuBuffer commands;             // 间接命令（常驻映射）
+        uint32_t outputCapacity = 0;
+        uint32_t commandCapacity = 0;
+        uint32_t drawCount = 0;
+        bool active = false;
+        vk::DescriptorSet descriptorSet;
+    };
+
+    //按需扩容；这一帧的fence已经等过，旧buffer可以直接释放
+    void ensureCapacity(FrameResources& f, uint32_t instances, uint32_t draws)
+    {
+        if (instances > f.outputCapacity) {
+            f.outputCapacity = std::max(instances, f.outputCapacity * 2);
+            f.output = createBuffer(*device, *allocator, sizeof(InstanceData) * (size_t)f.outputCapacity,
+                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer, MemoryUsage::GpuOnly);
+        }
+        if (draws > f.commandCapacity || !f.commands.mapped()) {
+            f.commandCapacity = std::max({ draws, f.commandCapacity * 2, 16u });
+            f.commands = createBuffer(*device, *allocator, sizeof(CullDrawCommand) * (size_t)f.commandCapacity,
+                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, MemoryUsage::CpuToGpu);
+        }
+    }
+
+    const vk::UniqueDevice* device;
+    GpuAllocator* allocator;
+    uint32_t indexCount;
+    std::array<float, 2> quadHalf;
+    std::vector<FrameResources> frames;
+    vk::UniqueDescriptorSetLayout setLayout;
+    vk::UniqueDescriptorPool descriptorPool;
+    vk::UniquePipelineLayout pipelineLayout;
+    vk::UniqueShaderModule shader;
+    uint32_t groupSize = 256;       // cull.comp的local_size_x
+    vk::DeviceSize maxStorageRange = 0;
+    vk::DeviceSize storageOffsetAlignment = 1;
+    bool warned = false;
+    vk::UniquePipeline pipeline;
+};
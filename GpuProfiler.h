@@ -0,0 +1,142 @@
+#pragma once
+#include "Tools.h"
+#include <map>
+
+//-----------------GPU时间戳----------------------
+//每套每帧资源一段query：录制时在pass/每段绘制前后写时间戳。这一帧的fence下一次被等过之后（framesInFlight帧以后）
+//再取结果，结果肯定已经写好，不用WAIT标志，不会卡CPU
+//GPU时钟没有和CPU时钟校准（需要VK_EXT_calibrated_timestamps），导出trace时把每帧最早的时间戳对齐到这一帧submit的CPU时间
+class GpuProfiler {
+public:
+    static constexpr uint32_t NoZone = UINT32_MAX;
+
+    //maxZonesPerFrame：每帧最多记录多少段，超出的段不记录（每段两个query），个数在report()里报出来
+    GpuProfiler(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        uint32_t queueFamily,
+        uint32_t framesInFlight,
+        uint32_t maxZonesPerFrame = 512)
+        : device(*device), maxZones(maxZonesPerFrame), frames(framesInFlight)
+    {
+        vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+        timestampPeriod = limits.timestampPeriod;
+        uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+        supported = validBits > 0 && timestampPeriod > 0.0f;
+        if (!supported) {
+            std::cout << "[profile] queue family has no timestamp support, gpu timings disabled" << std::endl;
+            return;
+        }
+        timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+        pool = device->createQueryPoolUnique({ {}, vk::QueryType::eTimestamp, framesInFlight * maxZones * 2 });
+        for (auto& f : frames) f.names.assign(maxZones, nullptr);
+    }
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    //fence等过之后、render pass之前调用：先取回这套资源上一轮的结果，再reset这一段query
+    void beginFrame(vk::CommandBuffer cmd, uint32_t frame)
+    {
+        if (!supported) return;
+        Frame& f = frames[frame];
+        if (f.submitted) resolve(f, frame);
+        cmd.resetQueryPool(*pool, frame * maxZones * 2, maxZones * 2);
+        f.used.store(0, std::memory_order_relaxed);
+        f.submitted = false;
+    }
+
+    //返回段编号，交给end()；可以在多个线程录制secondary时同时调用（段编号用原子计数分配）
+    uint32_t begin(vk::CommandBuffer cmd, uint32_t frame, const char* name)
+    {
+        if (!supported) return NoZone;
+        Frame& f = frames[frame];
+        uint32_t zone = f.used.fetch_add(1, std::memory_order_relaxed);
+        if (zone >= maxZones) return NoZone;
+        f.names[zone] = name;
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *pool, (frame * maxZones + zone) * 2);
+        return zone;
+    }
+
+    void end(vk::CommandBuffer cmd, uint32_t frame, uint32_t zone)
+    {
+        if (zone == NoZone) return;
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *pool, (frame * maxZones + zone) * 2 + 1);
+    }
+
+    //提交后调用：记下CPU时间，用来把这一帧的GPU时间段放到CPU时间轴上
+    void submitted(uint32_t frame)
+    {
+        if (!supported) return;
+        frames[frame].submitNs = GetProfiler().now();
+        frames[frame].submitted = true;
+    }
+
+    //按段名输出p50/p99并清空
+    void report()
+    {
+        if (!supported || (zoneTimes.empty() && droppedZones == 0)) return;
+        std::cout << "[profile] gpu";
+        for (auto& [name, histogram] : zoneTimes) {
+            std::cout << " | " << name << " x" << histogram.count() << " p50 " << histogram.percentile(0.5)
+                << " / p99 " << histogram.percentile(0.99) << " ms";
+            histogram.reset();
+        }
+        if (droppedZones) std::cout << " | " << droppedZones << " zones dropped (more than " << maxZones << " per frame)";
+        droppedZones = 0;
+        std::cout << std::endl;
+    }
+
+    //某个段名自上次report()以来的耗时分布，没有记录过返回空
+    const LatencyHistogram* zone(const std::string& name) const
+    {
+        auto it = zoneTimes.find(name);
+        return it == zoneTimes.end() ? nullptr : &it->second;
+    }
+
+    bool isSupported() const { return supported; }
+
+private:
+    struct Frame {
+        std::vector<const char*> names;
+        std::atomic<uint32_t> used{ 0 };
+        uint64_t submitNs = 0;
+        bool submitted = false;
+    };
+
+    void resolve(Frame& f, uint32_t frame)
+    {
+        uint32_t used = f.used.load(std::memory_order_relaxed);
+        uint32_t zoneCount = std::min(used, maxZones);
+        droppedZones += used - zoneCount;
+        if (zoneCount == 0) return;
+        std::vector<uint64_t> ticks(zoneCount * 2);
+        vk::Result result = device.getQueryPoolResults(*pool, frame * maxZones * 2, zoneCount * 2,
+            ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result != vk::Result::eSuccess) return;  // eNotReady：这一帧的数据丢掉，不等
+
+        uint64_t first = UINT64_MAX;
+        for (uint32_t z = 0; z < zoneCount; ++z) first = std::min(first, ticks[z * 2] & timestampMask);
+        bool trace = GetProfiler().isEnabled();
+        for (uint32_t z = 0; z < zoneCount; ++z) {
+            uint64_t start = ticks[z * 2] & timestampMask;
+            uint64_t end = ticks[z * 2 + 1] & timestampMask;
+            double durationNs = (double)((end - start) & timestampMask) * timestampPeriod;
+            zoneTimes.try_emplace(f.names[z], 0.01, 2000).first->second.add(durationNs / 1e6);
+            if (trace) {
+                uint64_t startNs = f.submitNs + (uint64_t)((double)((start - first) & timestampMask) * timestampPeriod);
+                GetProfiler().recordGpu(f.names[z], startNs, startNs + (uint64_t)durationNs);
+            }
+        }
+    }
+
+    vk::Device device;
+    uint32_t maxZones;
+    std::vector<Frame> frames;
+    bool supported = false;
+    float timestampPeriod = 0.0f;   // 每个tick多少纳秒
+    uint64_t timestampMask = UINT64_MAX;
+    vk::UniqueQueryPool pool;
+    std::map<std::string, LatencyHistogram> zoneTimes;
+    uint64_t droppedZones = 0;      // 上次report()以来超出maxZones没记录的段
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include "Tools.h"
+#include <functional>
+#include <cstdio>
+
+//-----------------Headless（无窗口离屏渲染）----------------------
+//渲染农场/CI机器没有显示器：不创建GLFW窗口和Surface，直接画到自己创建的VkImage上，再拷回CPU
+
+//读回的一帧：按行紧密排列的RGBA8像素
+using FrameCallback = std::function<void(uint64_t frameIndex, const uint8_t* rgba, uint32_t width, uint32_t height)>;
+
+//离屏画板：相当于swapchain里的一张图片 + 它的framebuffer
+struct OffscreenTarget {
+    vk::UniqueImage image;
+    vk::UniqueDeviceMemory memory;
+    vk::UniqueImageView view;
+    vk::UniqueFramebuffer framebuffer;
+};
+
+//读回环：每帧一个常驻映射的staging buffer，拷贝第N帧时不影响第N+1帧的渲染
+struct ReadbackSlot {
+    vk::UniqueBuffer buffer;
+    vk::UniqueDeviceMemory memory;
+    const uint8_t* mapped = nullptr;   // 创建时映射一次，之后不再map/unmap
+    bool pending = false;              // 已提交拷贝但还没交给回调
+    uint64_t frameIndex = 0;
+};
+
+//创建不带窗口扩展的 Vulkan 实例
+vk::UniqueInstance InitHeadlessInstance() {
+    PROFILE_SCOPE("InitHeadlessInstance");
+    vk::ApplicationInfo appInfo("Lesson 3", 1, "NoEngine", 1, VK_API_VERSION_1_2);
+    vk::InstanceCreateInfo createInfo({}, &appInfo);
+    return vk::createInstanceUnique(createInfo);
+}
+
+//没有Surface时，只要求队列支持图形
+std::optional<uint32_t> InitHeadlessGraphicFamily(const vk::PhysicalDevice& physicalDevice)
+{
+    auto families = physicalDevice.getQueueFamilyProperties();
+    for (uint32_t i = 0; i < families.size(); ++i) {
+        if (families[i].queueFlags & vk::QueueFlagBits::eGraphics) return i;
+    }
+    throw std::runtime_error("no suitable queue family found");
+}
+
+//创建离屏画板：颜色附件 + 传输源（用于读回）
+std::vector<OffscreenTarget> InitOffscreenTargets(
+    const vk::UniqueDevice& device,
+    const vk::PhysicalDevice& physicalDevice,
+    const vk::UniqueRenderPass& renderPass,
+    vk::Format format,
+    const vk::Extent2D& extent,
+    uint32_t count)
+{
+    std::vector<OffscreenTarget> targets(count);
+    for (auto& target : targets) {
+        vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, format, vk::Extent3D(extent, 1), 1, 1,
+            vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc);
+        target.image = device->createImageUnique(imageInfo);
+
+        auto memReq = device->getImageMemoryRequirements(*target.image);
+        vk::MemoryAllocateInfo allocInfo(memReq.size,
+            findMemoryType(physicalDevice, memReq.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        target.memory = device->allocateMemoryUnique(allocInfo);
+        device->bindImageMemory(*target.image, *target.memory, 0);
+
+        vk::ImageViewCreateInfo viewInfo({}, *target.image, vk::ImageViewType::e2D, format,
+            {}, { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+        target.view = device->createImageViewUnique(viewInfo);
+
+        vk::FramebufferCreateInfo fbInfo({}, *renderPass, 1, &*target.view, extent.width, extent.height, 1);
+        target.framebuffer = device->createFramebufferUnique(fbInfo);
+    }
+    return targets;
+}
+
+//创建读回环：优先 HOST_CACHED（CPU读取快很多），没有就退回普通的 HOST_COHERENT
+std::vector<ReadbackSlot> InitReadbackRing(
+    const vk::UniqueDevice& device,
+    const vk::PhysicalDevice& physicalDevice,
+    const vk::Extent2D& extent,
+    uint32_t count)
+{
+    vk::DeviceSize size = (vk::DeviceSize)extent.width * extent.height * 4;
+    std::vector<ReadbackSlot> ring(count);
+    for (auto& slot : ring) {
+        slot.buffer = device->createBufferUnique({ {}, size, vk::BufferUsageFlagBits::eTransferDst });
+        auto memReq = device->getBufferMemoryRequirements(*slot.buffer);
+
+        vk::MemoryPropertyFlags hostFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        uint32_t memoryType;
+        try {
+            memoryType = findMemoryType(physicalDevice, memReq.memoryTypeBits, hostFlags | vk::MemoryPropertyFlagBits::eHostCached);
+        }
+        catch (const std::runtime_error&) {
+            memoryType = findMemoryType(physicalDevice, memReq.memoryTypeBits, hostFlags);
+        }
+        slot.memory = device->allocateMemoryUnique({ memReq.size, memoryType });
+        device->bindBufferMemory(*slot.buffer, *slot.memory, 0);
+        slot.mapped = static_cast<const uint8_t*>(device->mapMemory(*slot.memory, 0, size));
+    }
+    return ring;
+}
+
+//在render pass之后录制：等颜色写完，再把画板拷进读回buffer
+//（render pass 的 finalLayout 必须是 eTransferSrcOptimal）
+void RecordReadback(
+    vk::CommandBuffer cmd,
+    const OffscreenTarget& target,
+    ReadbackSlot& slot,
+    const vk::Extent2D& extent,
+    uint64_t frameIndex)
+{
+    vk::ImageMemoryBarrier barrier(
+        vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
+        vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eTransferSrcOptimal,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+        *target.image, { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+        {}, nullptr, nullptr, barrier);
+
+    vk::BufferImageCopy region(0, 0, 0, { vk::ImageAspectFlagBits::eColor, 0, 0, 1 }, { 0, 0, 0 }, vk::Extent3D(extent, 1));
+    cmd.copyImageToBuffer(*target.image, vk::ImageLayout::eTransferSrcOptimal, *slot.buffer, region);
+
+    //让拷贝结果对主机可见（fence signal之后CPU再读）
+    vk::BufferMemoryBarrier hostBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *slot.buffer, 0, VK_WHOLE_SIZE);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+        {}, nullptr, hostBarrier, nullptr);
+
+    slot.pending = true;
+    slot.frameIndex = frameIndex;
+}
+
+//该slot对应的fence已经signal后调用：把像素交给回调
+void DeliverReadback(ReadbackSlot& slot, const vk::Extent2D& extent, const FrameCallback& callback)
+{
+    if (!slot.pending) return;
+    if (callback) callback(slot.frameIndex, slot.mapped, extent.width, extent.height);
+    slot.pending = false;
+}
+
+//写出PPM（P6，丢弃alpha）
+void WritePPM(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open " + path);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(width * 3);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* src = rgba + (size_t)y * width * 4;
+        for (uint32_t x = 0; x < width; ++x) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+}
+
+//写出原始RGBA8
+void WriteRaw(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("failed to open " + path);
+    file.write(reinterpret_cast<const char*>(rgba), (std::streamsize)width * height * 4);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Memory.h"
+
+//-----------------每帧实例环形缓冲----------------------
+//大量每帧都在动的精灵：实例数据不再一次性上传，而是CPU每帧直接写进常驻映射的缓冲
+//一个VkBuffer按 framesInFlight 切成若干段，第f帧只写第f段，GPU还在读的段不会被覆盖；
+//绘制时用 firstInstance 指向本帧的段，buffer绑定本身不用变
+template<typename T>
+class InstanceRing {
+public:
+    //extraUsage：例如GPU剔除时还要作为storage buffer读
+    InstanceRing(const vk::UniqueDevice& device, GpuAllocator& allocator, uint32_t framesInFlight, uint32_t initialCapacity = 1024,
+        vk::BufferUsageFlags extraUsage = {})
+        : device(&device), allocator(&allocator), framesInFlight(framesInFlight), extraUsage(extraUsage)
+    {
+        allocate(std::max<uint32_t>(initialCapacity, 1));
+    }
+
+    //开始写第frame帧的实例（调用前必须已经等过该帧的fence），返回可以直接写入的指针
+    //容量不够时整体扩容，旧buffer等所有在飞的帧都结束后再释放
+    T* begin(uint32_t frame, uint32_t count)
+    {
+        frameCounter++;
+        while (!retired.empty() && retired.front().releaseFrame <= frameCounter) retired.erase(retired.begin());
+
+        if (count > capacity) {
+            uint32_t newCapacity = capacity;
+            while (newCapacity < count) newCapacity *= 2;
+            retired.push_back({ std::move(ring), frameCounter + framesInFlight });
+            allocate(newCapacity);
+        }
+        currentFrame = frame;
+        instanceCount = count;
+        return static_cast<T*>(ring.mapped()) + (size_t)frame * capacity;
+    }
+
+    vk::Buffer buffer() const { return *ring; }
+    vk::DeviceSize bufferSize() const { return ring.size; }
+    uint32_t firstInstance() const { return currentFrame * capacity; }
+    uint32_t count() const { return instanceCount; }
+    uint32_t capacityPerFrame() const { return capacity; }
+
+private:
+    struct RetiredBuffer {
+        GpuBuffer buffer;
+        uint64_t releaseFrame;
+    };
+
+    void allocate(uint32_t newCapacity)
+    {
+        //每段按256字节对齐，段起点可以直接作为storage buffer偏移（minStorageBufferOffsetAlignment最大256）
+        uint32_t align = (uint32_t)std::max<size_t>(256 / sizeof(T), 1);
+        capacity = (newCapacity + align - 1) / align * align;
+        ring = createBuffer(*device, *allocator, sizeof(T) * (size_t)capacity * framesInFlight,
+            vk::BufferUsageFlagBits::eVertexBuffer | extraUsage, MemoryUsage::CpuToGpu);
+    }
+
+    const vk::UniqueDevice* device;
+    GpuAllocator* allocator;
+    uint32_t framesInFlight;
+    vk::BufferUsageFlags extraUsage;
+    uint32_t capacity = 0;          // 每帧最多多少个实例
+    uint32_t currentFrame = 0;
+    uint32_t instanceCount = 0;
+    uint64_t frameCounter = 0;
+    GpuBuffer ring;
+    std::vector<RetiredBuffer> retired;
+};
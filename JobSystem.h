@@ -0,0 +1,158 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+//-----------------任务系统（work stealing）----------------------
+//每个线程一个任务队列：自己从队尾取（刚放进去的，缓存还热），空了就从别人的队头偷（最老的、通常也最大的）
+//调用线程（主线程）占最后一个槽位，wait()时不会干等，而是一起执行任务
+//任务拿到的slot参数是当前线程的槽位号，可以用来索引每线程资源（比如command pool），同一槽位不会被两个线程同时使用
+class JobSystem {
+public:
+    using Job = std::function<void(uint32_t slot)>;
+
+    //一组任务的完成计数
+    struct Counter {
+        std::atomic<uint32_t> pending{ 0 };
+    };
+
+    //threadCount：额外开的工作线程数（0表示只有调用线程自己干活）
+    explicit JobSystem(uint32_t threadCount)
+    {
+        for (uint32_t i = 0; i < threadCount + 1; ++i) queues.push_back(std::make_unique<WorkQueue>());
+        for (uint32_t i = 0; i < threadCount; ++i) threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //槽位总数 = 工作线程 + 调用线程
+    uint32_t slotCount() const { return (uint32_t)queues.size(); }
+
+    //放进当前线程自己的队列
+    void run(Counter& counter, Job job)
+    {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        queued.fetch_add(1, std::memory_order_release);
+        WorkQueue& q = *queues[currentSlot()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back({ std::move(job), &counter });
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCv.notify_one();
+    }
+
+    //等这一组任务全部完成，等待期间帮忙执行任务
+    void wait(Counter& counter)
+    {
+        uint32_t slot = currentSlot();
+        while (counter.pending.load(std::memory_order_acquire) > 0) {
+            if (!runOne(slot)) std::this_thread::yield();
+        }
+    }
+
+    //把[0, count)按grain切块并行执行，fn(begin, end, slot)
+    void parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t, uint32_t)>& fn)
+    {
+        grain = std::max(grain, 1u);
+        Counter counter;
+        for (uint32_t begin = 0; begin < count; begin += grain) {
+            uint32_t end = std::min(begin + grain, count);
+            run(counter, [&fn, begin, end](uint32_t slot) { fn(begin, end, slot); });
+        }
+        wait(counter);
+    }
+
+private:
+    struct Task {
+        Job job;
+        Counter* counter = nullptr;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    //不是本系统的线程（主线程）都用最后一个槽位
+    uint32_t currentSlot() const
+    {
+        return tlsOwner == this ? tlsSlot : (uint32_t)queues.size() - 1;
+    }
+
+    bool runOne(uint32_t slot)
+    {
+        Task task;
+        if (!popLocal(slot, task) && !steal(slot, task)) return false;
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        task.job(slot);
+        task.counter->pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    bool popLocal(uint32_t slot, Task& task)
+    {
+        WorkQueue& q = *queues[slot];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(uint32_t slot, Task& task)
+    {
+        uint32_t n = (uint32_t)queues.size();
+        for (uint32_t i = 1; i < n; ++i) {
+            WorkQueue& q = *queues[(slot + i) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(uint32_t slot)
+    {
+        tlsOwner = this;
+        tlsSlot = slot;
+        for (;;) {
+            if (runOne(slot)) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCv.wait(lock, [&] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+            if (stopping) return;
+        }
+    }
+
+    inline static thread_local const JobSystem* tlsOwner = nullptr;
+    inline static thread_local uint32_t tlsSlot = 0;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> queued{ 0 };      // 所有队列里还没被取走的任务数
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    bool stopping = false;
+};
@@ -0,0 +1,647 @@
+#pragma once
+#include "Tools.h"
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+//-----------------GPU内存子分配器----------------------
+//每个Buffer都单独vkAllocateMemory会很快撞上 maxMemoryAllocationCount（很多驱动只有4096），
+//这里先向驱动要大块内存（Block），再在块内切小段分给各个Buffer/Image
+
+//内存用途：决定去哪种内存类型里分配
+enum class MemoryUsage {
+    GpuOnly,    // 静态数据：DEVICE_LOCAL，通过staging上传
+    CpuToGpu,   // 每帧CPU写、GPU读：HOST_VISIBLE | HOST_COHERENT，常驻映射
+    GpuToCpu    // 读回：HOST_VISIBLE | HOST_COHERENT，尽量 HOST_CACHED
+};
+
+//块内切分策略
+enum class AllocStrategy {
+    FreeList,   // 空闲区间表 + 最佳适配 + 释放时合并，适合生命周期不规则的资源
+    Ring        // 环形线性分配，只能按分配顺序（FIFO）回收，适合staging/每帧临时数据
+};
+
+//一次子分配的结果
+struct Allocation {
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mapped = nullptr;           // 块是HOST_VISIBLE时指向这段内存的CPU地址，否则为空
+    uint32_t poolIndex = UINT32_MAX;
+    uint32_t blockIndex = UINT32_MAX;
+
+    explicit operator bool() const { return poolIndex != UINT32_MAX; }
+};
+
+//分配器统计
+struct AllocatorStats {
+    uint32_t blockCount = 0;              // 实际 vkAllocateMemory 次数
+    uint32_t allocationCount = 0;         // 子分配个数
+    vk::DeviceSize bytesReserved = 0;     // 向驱动申请的总字节数
+    vk::DeviceSize bytesUsed = 0;         // 分出去的字节数
+    float fragmentation = 0.0f;           // 1 - 最大空闲区间/空闲总量（0表示空闲空间都连在一起）
+};
+
+//一大块 VkDeviceMemory
+class MemoryBlock {
+public:
+    MemoryBlock(vk::Device device, uint32_t memoryType, vk::DeviceSize size, bool hostVisible, AllocStrategy strategy)
+        : device(device), size(size), strategy(strategy)
+    {
+        memory = device.allocateMemoryUnique({ size, memoryType });
+        if (hostVisible) mapped = static_cast<uint8_t*>(device.mapMemory(*memory, 0, size));
+        freeRanges[0] = size;
+    }
+
+    //分配成功返回偏移
+    std::optional<vk::DeviceSize> allocate(vk::DeviceSize allocSize, vk::DeviceSize alignment)
+    {
+        return strategy == AllocStrategy::Ring ? allocateRing(allocSize, alignment) : allocateFreeList(allocSize, alignment);
+    }
+
+    void free(vk::DeviceSize offset, vk::DeviceSize allocSize)
+    {
+        used -= allocSize;
+        allocationCount--;
+        if (strategy == AllocStrategy::Ring) freeRing(offset);
+        else freeFreeList(offset, allocSize);
+    }
+
+    vk::DeviceMemory handle() const { return *memory; }
+    uint8_t* hostPointer() const { return mapped; }
+    vk::DeviceSize capacity() const { return size; }
+    vk::DeviceSize usedBytes() const { return used; }
+    uint32_t allocations() const { return allocationCount; }
+
+    //空闲总量与最大连续空闲区间
+    std::pair<vk::DeviceSize, vk::DeviceSize> freeSpace() const
+    {
+        if (strategy == AllocStrategy::Ring) {
+            vk::DeviceSize largest = size;
+            if (!ringEntries.empty()) {
+                vk::DeviceSize tail = ringEntries.front().offset;
+                largest = ringWrapped() ? tail - ringHead : std::max(size - ringHead, tail);
+            }
+            return { size - used, largest };
+        }
+        vk::DeviceSize total = 0, largest = 0;
+        for (auto& [offset, rangeSize] : freeRanges) {
+            total += rangeSize;
+            largest = std::max(largest, rangeSize);
+        }
+        return { total, largest };
+    }
+
+private:
+    static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //最佳适配：找能放下的最小空闲区间，剩下的头尾重新挂回空闲表
+    std::optional<vk::DeviceSize> allocateFreeList(vk::DeviceSize allocSize, vk::DeviceSize alignment)
+    {
+        auto best = freeRanges.end();
+        vk::DeviceSize bestWaste = ~vk::DeviceSize(0);
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+            vk::DeviceSize aligned = alignUp(it->first, alignment);
+            if (aligned + allocSize > it->first + it->second) continue;
+            vk::DeviceSize waste = it->second - allocSize;
+            if (waste < bestWaste) {
+                best = it;
+                bestWaste = waste;
+                if (waste == 0) break;
+            }
+        }
+        if (best == freeRanges.end()) return std::nullopt;
+
+        vk::DeviceSize rangeOffset = best->first, rangeSize = best->second;
+        vk::DeviceSize aligned = alignUp(rangeOffset, alignment);
+        freeRanges.erase(best);
+        if (aligned > rangeOffset) freeRanges[rangeOffset] = aligned - rangeOffset;
+        vk::DeviceSize end = aligned + allocSize;
+        if (end < rangeOffset + rangeSize) freeRanges[end] = rangeOffset + rangeSize - end;
+
+        used += allocSize;
+        allocationCount++;
+        return aligned;
+    }
+
+    //归还区间并和前后相邻的空闲区间合并
+    void freeFreeList(vk::DeviceSize offset, vk::DeviceSize allocSize)
+    {
+        auto it = freeRanges.emplace(offset, allocSize).first;
+        auto next = std::next(it);
+        if (next != freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeRanges.erase(next);
+        }
+        if (it != freeRanges.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first) {
+                prev->second += it->second;
+                freeRanges.erase(it);
+            }
+        }
+    }
+
+    //环形分配：从head往后切，到尾部放不下就绕回开头（前提是开头那段已经按顺序回收）
+    std::optional<vk::DeviceSize> allocateRing(vk::DeviceSize allocSize, vk::DeviceSize alignment)
+    {
+        if (ringEntries.empty()) ringHead = 0;
+        vk::DeviceSize aligned = alignUp(ringHead, alignment);
+
+        if (!ringEntries.empty()) {
+            vk::DeviceSize tail = ringEntries.front().offset;
+            if (!ringWrapped()) {
+                // 在用区间是[tail, head)：先试尾部，放不下再绕回[0, tail)
+                if (aligned + allocSize > size) {
+                    if (allocSize > tail) return std::nullopt;
+                    aligned = 0;
+                }
+            }
+            else if (aligned + allocSize > tail) {
+                // 已经绕回：空闲区间只有[head, tail)
+                return std::nullopt;
+            }
+        }
+        if (aligned + allocSize > size) return std::nullopt;
+
+        ringEntries.push_back({ aligned, allocSize, false });
+        ringHead = aligned + allocSize;
+        used += allocSize;
+        allocationCount++;
+        return aligned;
+    }
+
+    //最新的一段在最旧的一段前面，说明已经绕回开头
+    bool ringWrapped() const
+    {
+        return !ringEntries.empty() && ringEntries.back().offset < ringEntries.front().offset;
+    }
+
+    //只标记；队首的已释放段依次出队，tail前移
+    void freeRing(vk::DeviceSize offset)
+    {
+        for (auto& entry : ringEntries) {
+            if (entry.offset == offset && !entry.freed) {
+                entry.freed = true;
+                break;
+            }
+        }
+        while (!ringEntries.empty() && ringEntries.front().freed) ringEntries.pop_front();
+    }
+
+    struct RingEntry {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+        bool freed;
+    };
+
+    vk::Device device;
+    vk::UniqueDeviceMemory memory;
+    vk::DeviceSize size = 0;
+    vk::DeviceSize used = 0;
+    uint32_t allocationCount = 0;
+    uint8_t* mapped = nullptr;
+    AllocStrategy strategy;
+    std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;    // FreeList：offset -> size
+    std::deque<RingEntry> ringEntries;                      // Ring：按分配顺序排列的在用段
+    vk::DeviceSize ringHead = 0;
+};
+
+//分配器：按 (内存类型, 策略) 分池，每个池若干个Block
+class GpuAllocator {
+public:
+    GpuAllocator(const vk::UniqueDevice& device, const vk::PhysicalDevice& physicalDevice, vk::DeviceSize blockSize = 64ull << 20)
+        : device(*device), physicalDevice(physicalDevice), blockSize(blockSize)
+    {
+        memProperties = physicalDevice.getMemoryProperties();
+        auto limits = physicalDevice.getProperties().limits;
+        maxAllocationCount = limits.maxMemoryAllocationCount;
+        bufferImageGranularity = limits.bufferImageGranularity;
+    }
+
+    GpuAllocator(const GpuAllocator&) = delete;
+    GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+    Allocation allocate(const vk::MemoryRequirements& req, MemoryUsage usage, AllocStrategy strategy = AllocStrategy::FreeList)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t memoryType = chooseMemoryType(req.memoryTypeBits, usage);
+        //Buffer和Image混放在同一块里，按 bufferImageGranularity 对齐就不会互相踩到
+        vk::DeviceSize alignment = std::max(req.alignment, bufferImageGranularity);
+
+        uint32_t poolIndex = findPool(memoryType, strategy);
+        Pool& pool = pools[poolIndex];
+        for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+            if (!pool.blocks[i]) continue;
+            if (auto offset = pool.blocks[i]->allocate(req.size, alignment))
+                return makeAllocation(poolIndex, i, *offset, req.size);
+        }
+
+        //现有块都放不下：新开一块（超大的资源单独一块）
+        if (totalBlocks() >= maxAllocationCount)
+            throw std::runtime_error("GpuAllocator: maxMemoryAllocationCount reached!");
+        vk::DeviceSize newBlockSize = std::max(blockSize, req.size);
+        bool hostVisible = (bool)(memProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+        uint32_t blockIndex = (uint32_t)pool.blocks.size();
+        for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+            if (!pool.blocks[i]) { blockIndex = i; break; }
+        }
+        auto block = std::make_unique<MemoryBlock>(device, memoryType, newBlockSize, hostVisible, strategy);
+        auto offset = block->allocate(req.size, alignment);
+        if (blockIndex == pool.blocks.size()) pool.blocks.push_back(std::move(block));
+        else pool.blocks[blockIndex] = std::move(block);
+        return makeAllocation(poolIndex, blockIndex, *offset, req.size);
+    }
+
+    void free(const Allocation& allocation)
+    {
+        if (!allocation) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        Pool& pool = pools[allocation.poolIndex];
+        auto& block = pool.blocks[allocation.blockIndex];
+        block->free(allocation.offset, allocation.size);
+        //空块还给驱动，但每个池保留一块避免反复申请释放
+        if (block->allocations() == 0 && countBlocks(pool) > 1) block.reset();
+    }
+
+    bool isHostCoherent(const Allocation& allocation) const
+    {
+        return (bool)(memProperties.memoryTypes[pools[allocation.poolIndex].memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    AllocatorStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        AllocatorStats s;
+        vk::DeviceSize totalFree = 0, largestFree = 0;
+        for (auto& pool : pools) {
+            for (auto& block : pool.blocks) {
+                if (!block) continue;
+                s.blockCount++;
+                s.allocationCount += block->allocations();
+                s.bytesReserved += block->capacity();
+                s.bytesUsed += block->usedBytes();
+                auto [freeBytes, largest] = block->freeSpace();
+                totalFree += freeBytes;
+                largestFree = std::max(largestFree, largest);
+            }
+        }
+        s.fragmentation = totalFree ? 1.0f - (float)largestFree / (float)totalFree : 0.0f;
+        return s;
+    }
+
+private:
+    struct Pool {
+        uint32_t memoryType;
+        AllocStrategy strategy;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    };
+
+    //按用途挑内存类型：先找"最理想"的组合，找不到再退回最低要求
+    uint32_t chooseMemoryType(uint32_t typeBits, MemoryUsage usage) const
+    {
+        using F = vk::MemoryPropertyFlagBits;
+        std::vector<vk::MemoryPropertyFlags> candidates;
+        switch (usage) {
+        case MemoryUsage::GpuOnly:
+            candidates = { F::eDeviceLocal, {} };
+            break;
+        case MemoryUsage::CpuToGpu:
+            candidates = { F::eHostVisible | F::eHostCoherent };
+            break;
+        case MemoryUsage::GpuToCpu:
+            candidates = { F::eHostVisible | F::eHostCoherent | F::eHostCached, F::eHostVisible | F::eHostCoherent };
+            break;
+        }
+        for (auto flags : candidates) {
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+                if ((typeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & flags) == flags) return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    uint32_t findPool(uint32_t memoryType, AllocStrategy strategy)
+    {
+        for (uint32_t i = 0; i < pools.size(); ++i) {
+            if (pools[i].memoryType == memoryType && pools[i].strategy == strategy) return i;
+        }
+        pools.push_back({ memoryType, strategy, {} });
+        return (uint32_t)pools.size() - 1;
+    }
+
+    Allocation makeAllocation(uint32_t poolIndex, uint32_t blockIndex, vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        const MemoryBlock& block = *pools[poolIndex].blocks[blockIndex];
+        Allocation allocation;
+        allocation.memory = block.handle();
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block.hostPointer() ? block.hostPointer() + offset : nullptr;
+        allocation.poolIndex = poolIndex;
+        allocation.blockIndex = blockIndex;
+        return allocation;
+    }
+
+    static uint32_t countBlocks(const Pool& pool)
+    {
+        return (uint32_t)std::count_if(pool.blocks.begin(), pool.blocks.end(), [](auto& b) { return b != nullptr; });
+    }
+
+    uint32_t totalBlocks() const
+    {
+        uint32_t count = 0;
+        for (auto& pool : pools) count += countBlocks(pool);
+        return count;
+    }
+
+    vk::Device device;
+    vk::PhysicalDevice physicalDevice;
+    vk::PhysicalDeviceMemoryProperties memProperties;
+    vk::DeviceSize blockSize;
+    vk::DeviceSize bufferImageGranularity = 1;
+    uint32_t maxAllocationCount = 4096;
+    std::vector<Pool> pools;
+    mutable std::mutex mutex;
+};
+
+//子分配出来的Buffer：析构时把内存段还给分配器
+struct GpuBuffer {
+    vk::UniqueBuffer buffer;
+    Allocation allocation;
+    GpuAllocator* allocator = nullptr;
+    vk::DeviceSize size = 0;
+
+    GpuBuffer() = default;
+    GpuBuffer(GpuBuffer&& other) noexcept { *this = std::move(other); }
+    GpuBuffer& operator=(GpuBuffer&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            buffer = std::move(other.buffer);
+            allocation = other.allocation;
+            allocator = other.allocator;
+            size = other.size;
+            other.allocation = {};
+            other.allocator = nullptr;
+        }
+        return *this;
+    }
+    ~GpuBuffer() { release(); }
+
+    void release()
+    {
+        buffer.reset();
+        if (allocator) allocator->free(allocation);
+        allocation = {};
+        allocator = nullptr;
+    }
+
+    vk::Buffer operator*() const { return *buffer; }
+    void* mapped() const { return allocation.mapped; }
+};
+
+//从分配器里创建Buffer（GpuOnly的数据需要再通过 StagingUploader 上传）
+GpuBuffer createBuffer(
+    const vk::UniqueDevice& device,
+    GpuAllocator& allocator,
+    size_t size,
+    vk::BufferUsageFlags usage,
+    MemoryUsage memoryUsage,
+    AllocStrategy strategy = AllocStrategy::FreeList)
+{
+    PROFILE_SCOPE("createBuffer");
+    GpuBuffer result;
+    result.buffer = device->createBufferUnique({ {}, size, usage });
+    result.allocation = allocator.allocate(device->getBufferMemoryRequirements(*result.buffer), memoryUsage, strategy);
+    result.allocator = &allocator;
+    result.size = size;
+    device->bindBufferMemory(*result.buffer, result.allocation.memory, result.allocation.offset);
+    return result;
+}
+
+//子分配出来的Image（带一个覆盖全部mip的view）
+struct GpuImage {
+    vk::UniqueImage image;
+    vk::UniqueImageView view;
+    Allocation allocation;
+    GpuAllocator* allocator = nullptr;
+    vk::Extent2D extent;
+    uint32_t mipLevels = 1;
+
+    GpuImage() = default;
+    GpuImage(GpuImage&& other) noexcept { *this = std::move(other); }
+    GpuImage& operator=(GpuImage&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            image = std::move(other.image);
+            view = std::move(other.view);
+            allocation = other.allocation;
+            allocator = other.allocator;
+            extent = other.extent;
+            mipLevels = other.mipLevels;
+            other.allocation = {};
+            other.allocator = nullptr;
+        }
+        return *this;
+    }
+    ~GpuImage() { release(); }
+
+    void release()
+    {
+        view.reset();
+        image.reset();
+        if (allocator) allocator->free(allocation);
+        allocation = {};
+        allocator = nullptr;
+    }
+
+    vk::Image operator*() const { return *image; }
+};
+
+//创建2D贴图（DEVICE_LOCAL，内容通过 StagingUploader::uploadImage 上传）
+GpuImage createImage(
+    const vk::UniqueDevice& device,
+    GpuAllocator& allocator,
+    vk::Extent2D extent,
+    uint32_t mipLevels,
+    vk::Format format,
+    vk::ImageUsageFlags usage)
+{
+    PROFILE_SCOPE("createImage");
+    GpuImage result;
+    vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, format, vk::Extent3D(extent, 1), mipLevels, 1,
+        vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage);
+    result.image = device->createImageUnique(imageInfo);
+    result.allocation = allocator.allocate(device->getImageMemoryRequirements(*result.image), MemoryUsage::GpuOnly);
+    result.allocator = &allocator;
+    result.extent = extent;
+    result.mipLevels = mipLevels;
+    device->bindImageMemory(*result.image, result.allocation.memory, result.allocation.offset);
+    result.view = device->createImageViewUnique({ {}, *result.image, vk::ImageViewType::e2D, format, {},
+        { vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1 } });
+    return result;
+}
+
+//一级mip的像素（按行紧密排列）
+struct ImageMip {
+    uint32_t width;
+    uint32_t height;
+    const void* data;
+};
+
+//批量上传：先把数据拷进环形staging buffer并录制copy命令，flush时一次submit提交整批
+class StagingUploader {
+public:
+    StagingUploader(
+        const vk::UniqueDevice& device,
+        GpuAllocator& allocator,
+        vk::Queue queue,
+        uint32_t queueFamily,
+        vk::DeviceSize ringSize = 16ull << 20)
+        : device(*device), queue(queue), ringSize(ringSize)
+    {
+        staging = createBuffer(device, allocator, ringSize, vk::BufferUsageFlagBits::eTransferSrc, MemoryUsage::CpuToGpu);
+        commandPool = device->createCommandPoolUnique({ vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamily });
+        commandBuffer = std::move(device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0]);
+        fence = device->createFenceUnique({});
+    }
+
+    //把一段数据排进当前批次；放不下时先flush上一批，超过整个环的数据分段上传
+    void upload(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size)
+    {
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            vk::DeviceSize chunk = std::min(size, ringSize);
+            vk::DeviceSize offset = reserve(chunk, 4);
+            memcpy(static_cast<uint8_t*>(staging.mapped()) + offset, src, chunk);
+            commandBuffer->copyBuffer(*staging, dst, vk::BufferCopy(offset, dstOffset, chunk));
+            src += chunk;
+            dstOffset += chunk;
+            size -= chunk;
+        }
+    }
+
+    void upload(const GpuBuffer& dst, const void* data, vk::DeviceSize size)
+    {
+        upload(*dst, 0, data, size);
+    }
+
+    //贴图上传：整条mip链 UNDEFINED -> TRANSFER_DST，逐级拷贝（一级比整个环还大时按行分段），
+    //最后转成 SHADER_READ_ONLY 给片段着色器采样
+    void uploadImage(vk::Image dst, const std::vector<ImageMip>& mips, uint32_t texelSize = 4)
+    {
+        vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, (uint32_t)mips.size(), 0, 1);
+        beginRecording();
+        transition(dst, range, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+            {}, vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+
+        for (uint32_t level = 0; level < mips.size(); ++level) {
+            const ImageMip& mip = mips[level];
+            vk::DeviceSize rowBytes = (vk::DeviceSize)mip.width * texelSize;
+            if (rowBytes > ringSize) throw std::runtime_error("image row larger than staging ring!");
+            uint32_t rowsPerChunk = (uint32_t)std::min<vk::DeviceSize>(ringSize / rowBytes, mip.height);
+            const uint8_t* src = static_cast<const uint8_t*>(mip.data);
+            for (uint32_t y = 0; y < mip.height; y += rowsPerChunk) {
+                uint32_t rows = std::min(rowsPerChunk, mip.height - y);
+                vk::DeviceSize chunk = rowBytes * rows;
+                vk::DeviceSize offset = reserve(chunk, std::max(texelSize, 4u));
+                memcpy(static_cast<uint8_t*>(staging.mapped()) + offset, src + rowBytes * y, chunk);
+                vk::BufferImageCopy region(offset, 0, 0, { vk::ImageAspectFlagBits::eColor, level, 0, 1 },
+                    { 0, (int32_t)y, 0 }, { mip.width, rows, 1 });
+                commandBuffer->copyBufferToImage(*staging, dst, vk::ImageLayout::eTransferDstOptimal, region);
+            }
+        }
+
+        transition(dst, range, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+    }
+
+    //提交这一批：一次submit，等待完成后复用整个环
+    void flush()
+    {
+        if (!recording) return;
+        PROFILE_SCOPE("StagingUploader::flush");
+        //让拷贝结果对之后所有阶段可见
+        vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead);
+        commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+            {}, barrier, nullptr, nullptr);
+        commandBuffer->end();
+
+        vk::SubmitInfo submitInfo;
+        submitInfo.setCommandBuffers(*commandBuffer);
+        queue.submit(submitInfo, *fence);
+        if (device.waitForFences(*fence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+            throw std::runtime_error("failed to wait for upload fence!");
+        device.resetFences(*fence);
+        commandBuffer->reset();
+
+        recording = false;
+        head = 0;
+        bytesUploaded += pendingBytes;
+        pendingBytes = 0;
+        submitCount++;
+    }
+
+    vk::DeviceSize totalBytesUploaded() const { return bytesUploaded; }
+    uint32_t totalSubmits() const { return submitCount; }
+
+private:
+    vk::DeviceSize reserve(vk::DeviceSize size, vk::DeviceSize alignment)
+    {
+        vk::DeviceSize offset = (head + alignment - 1) / alignment * alignment;
+        if (offset + size > ringSize) {
+            flush();
+            offset = 0;
+        }
+        beginRecording();
+        head = offset + size;
+        pendingBytes += size;
+        return offset;
+    }
+
+    void beginRecording()
+    {
+        if (recording) return;
+        commandBuffer->begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        recording = true;
+    }
+
+    void transition(vk::Image image, const vk::ImageSubresourceRange& range, vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+        vk::AccessFlags srcAccess, vk::AccessFlags dstAccess, vk::PipelineStageFlags srcStage, vk::PipelineStageFlags dstStage)
+    {
+        vk::ImageMemoryBarrier barrier(srcAccess, dstAccess, oldLayout, newLayout,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+        commandBuffer->pipelineBarrier(srcStage, dstStage, {}, nullptr, nullptr, barrier);
+    }
+
+    vk::Device device;
+    vk::Queue queue;
+    vk::DeviceSize ringSize;
+    GpuBuffer staging;
+    vk::UniqueCommandPool commandPool;
+    vk::UniqueCommandBuffer commandBuffer;
+    vk::UniqueFence fence;
+    vk::DeviceSize head = 0;
+    vk::DeviceSize pendingBytes = 0;
+    vk::DeviceSize bytesUploaded = 0;
+    uint32_t submitCount = 0;
+    bool recording = false;
+};
+
+//打印分配器统计
+void PrintAllocatorStats(const GpuAllocator& allocator)
+{
+    AllocatorStats s = allocator.stats();
+    std::cout << "[memory] blocks " << s.blockCount
+        << ", allocations " << s.allocationCount
+        << ", used " << s.bytesUsed / 1024 << " KB / reserved " << s.bytesReserved / 1024 << " KB"
+        << ", fragmentation " << s.fragmentation * 100.0f << "%" << std::endl;
+}
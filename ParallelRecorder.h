@@ -0,0 +1,85 @@
+#pragma once
+#include "Tools.h"
+#include "JobSystem.h"
+#include <functional>
+
+//-----------------多线程录制----------------------
+//VkCommandPool不能多线程同时使用，所以每帧、每个线程槽位各一个pool；
+//绘制列表切成若干段，由任务系统分给各线程录进secondary command buffer，primary按原顺序 executeCommands
+//pool在这一帧的fence等过之后整体reset，不逐个释放command buffer
+class ParallelRecorder {
+public:
+    //minDrawsPerChunk：一段至少多少个draw，太碎的话录制省下的时间还不够调度开销
+    ParallelRecorder(
+        const vk::UniqueDevice& device,
+        uint32_t queueFamily,
+        uint32_t framesInFlight,
+        JobSystem& jobs,
+        uint32_t minDrawsPerChunk = 256)
+        : device(*device), jobs(&jobs), minDrawsPerChunk(std::max(minDrawsPerChunk, 1u)), frames(framesInFlight)
+    {
+        for (auto& f : frames) {
+            f.slots.resize(jobs.slotCount());
+            for (auto& slot : f.slots)
+                slot.pool = device->createCommandPoolUnique({ vk::CommandPoolCreateFlagBits::eTransient, queueFamily });
+        }
+    }
+
+    //把[0, drawCount)切段并行录制；fn(cmd, begin, end) 在工作线程里调用，cmd已经begin，
+    //fn负责设置状态并画这一段。返回按段顺序排好的secondary，直接交给 executeCommands
+    const std::vector<vk::CommandBuffer>& record(
+        uint32_t frame,
+        uint32_t drawCount,
+        const vk::CommandBufferInheritanceInfo& inheritance,
+        const std::function<void(vk::CommandBuffer, uint32_t, uint32_t)>& fn)
+    {
+        Frame& f = frames[frame];
+        for (auto& slot : f.slots) {
+            device.resetCommandPool(*slot.pool);
+            slot.used = 0;
+        }
+
+        //段数：够每个线程分几段（方便偷任务做负载均衡），但每段不少于minDrawsPerChunk
+        uint32_t chunkCount = (drawCount + minDrawsPerChunk - 1) / minDrawsPerChunk;
+        chunkCount = std::clamp(chunkCount, 1u, jobs->slotCount() * 4);
+        f.secondaries.assign(chunkCount, {});
+
+        jobs->parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end, uint32_t slotIndex) {
+            for (uint32_t c = begin; c < end; ++c) {
+                vk::CommandBuffer cmd = acquire(f.slots[slotIndex]);
+                cmd.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance });
+                fn(cmd, (uint32_t)((uint64_t)drawCount * c / chunkCount), (uint32_t)((uint64_t)drawCount * (c + 1) / chunkCount));
+                cmd.end();
+                f.secondaries[c] = cmd;
+            }
+        });
+        return f.secondaries;
+    }
+
+private:
+    struct Slot {
+        vk::UniqueCommandPool pool;
+        std::vector<vk::CommandBuffer> buffers;     // 随pool一起释放
+        uint32_t used = 0;
+    };
+
+    struct Frame {
+        std::vector<Slot> slots;
+        std::vector<vk::CommandBuffer> secondaries;
+    };
+
+    //每个槽位只会被一个线程使用，不用加锁
+    vk::CommandBuffer acquire(Slot& slot)
+    {
+        if (slot.used == slot.buffers.size()) {
+            auto buffers = device.allocateCommandBuffers({ *slot.pool, vk::CommandBufferLevel::eSecondary, 1 });
+            slot.buffers.push_back(buffers[0]);
+        }
+        return slot.buffers[slot.used++];
+    }
+
+    vk::Device device;
+    JobSystem* jobs;
+    uint32_t minDrawsPerChunk;
+    std::vector<Frame> frames;
+};
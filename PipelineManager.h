@@ -0,0 +1,332 @@
+#pragma once
+#include "Tools.h"
+#include "ShaderLibrary.h"
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <filesystem>
+#include <algorithm>
+
+//-----------------Pipeline管理----------------------
+//pipeline按状态的哈希索引，缓存在 VkPipelineCache 里并序列化到磁盘（下次启动直接命中驱动缓存）；
+//变体交给后台线程编译，没编好之前 get() 返回指定的后备pipeline，渲染线程永远不会卡在编译上
+//viewport/scissor 是动态状态，窗口大小变化不需要重建pipeline
+//shader来自 ShaderLibrary；shader热重载后 reload() 在后台重建用到它的pipeline，编好之前继续用旧的
+
+//混合模式
+enum class BlendMode : uint8_t {
+    Opaque,     // 不混合
+    Alpha,      // src * a + dst * (1 - a)
+    Additive    // src * a + dst
+};
+
+//决定一条graphics pipeline的全部可变状态（render pass和pipeline layout由管理器固定）
+struct PipelineDesc {
+    std::string vertShader;     // GLSL源码路径（由 ShaderLibrary 编译）
+    std::string fragShader;
+    BlendMode blend = BlendMode::Opaque;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    std::vector<vk::VertexInputBindingDescription> bindings;
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+
+    //FNV-1a：相同状态得到相同的键
+    uint64_t hash() const
+    {
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&](const void* data, size_t size) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                h ^= bytes[i];
+                h *= 1099511628211ull;
+            }
+        };
+        mix(vertShader.data(), vertShader.size());
+        mix("|", 1);
+        mix(fragShader.data(), fragShader.size());
+        mix(&blend, sizeof(blend));
+        mix(&topology, sizeof(topology));
+        for (auto& b : bindings) {
+            uint32_t v[3] = { b.binding, b.stride, (uint32_t)b.inputRate };
+            mix(v, sizeof(v));
+        }
+        for (auto& a : attributes) {
+            uint32_t v[4] = { a.location, a.binding, (uint32_t)a.format, a.offset };
+            mix(v, sizeof(v));
+        }
+        return h;
+    }
+};
+
+class PipelineManager {
+public:
+    //threadCount为0时按CPU核数减一
+    PipelineManager(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        const vk::UniqueRenderPass& renderPass,
+        vk::PipelineLayout pipelineLayout,
+        ShaderLibrary& shaders,
+        const std::string& cachePath,
+        uint32_t threadCount = 0)
+        : device(&device), renderPass(*renderPass), pipelineLayout(pipelineLayout), shaders(&shaders), cachePath(cachePath)
+    {
+        properties = physicalDevice.getProperties();
+        std::vector<char> initialData = loadCacheFile();
+        cache = device->createPipelineCacheUnique({ {}, initialData.size(), initialData.data() });
+
+        if (threadCount == 0) threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (uint32_t i = 0; i < threadCount; ++i) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~PipelineManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            queue.clear();
+        }
+        queueCv.notify_all();
+        for (auto& t : workers) t.join();
+        save();
+    }
+
+    PipelineManager(const PipelineManager&) = delete;
+    PipelineManager& operator=(const PipelineManager&) = delete;
+
+    //登记一个变体并排进后台编译队列（已登记过的直接返回键）
+    //fallback：没编好或编译失败时 get() 改用哪条pipeline（0表示没有）
+    uint64_t request(const PipelineDesc& desc, uint64_t fallback = 0)
+    {
+        uint64_t key = desc.hash();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (entries.count(key)) return key;
+            auto entry = std::make_unique<Entry>();
+            entry->desc = desc;
+            entry->fallback = fallback;
+            entries.emplace(key, std::move(entry));
+            queue.push_back(key);
+        }
+        queueCv.notify_one();
+        return key;
+    }
+
+    //渲染线程用：编好了返回它，否则沿fallback链往下找，都没有返回空
+    vk::Pipeline get(uint64_t key) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int depth = 0; key != 0 && depth < 8; ++depth) {
+            auto it = entries.find(key);
+            if (it == entries.end()) return {};
+            const Entry& e = *it->second;
+            if (e.state == State::Ready) return *e.pipeline;
+            key = e.fallback;
+        }
+        return {};
+    }
+
+    //阻塞到这条pipeline编好（启动时的基础pipeline用）；编译失败抛异常
+    vk::Pipeline wait(uint64_t key)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        Entry& e = *entries.at(key);
+        readyCv.wait(lock, [&] { return e.state != State::Pending; });
+        if (e.state == State::Failed) throw std::runtime_error("failed to create pipeline!");
+        return *e.pipeline;
+    }
+
+    bool ready(uint64_t key) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        return it != entries.end() && it->second->state == State::Ready;
+    }
+
+    //热重载：重建用到这些shader的pipeline（后台编译，编好之前 get() 仍返回旧的，编译失败就一直用旧的）
+    //调用前GPU必须空闲：上一次重载换下来的旧pipeline在这里释放。返回排进队列的pipeline数
+    uint32_t reload(const std::vector<std::string>& shaderPaths)
+    {
+        uint32_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired.clear();
+            for (auto& [key, e] : entries) {
+                if (e->state == State::Pending) continue;  // 还没编译，编译时自然用到新shader
+                bool uses = std::find(shaderPaths.begin(), shaderPaths.end(), e->desc.vertShader) != shaderPaths.end()
+                    || std::find(shaderPaths.begin(), shaderPaths.end(), e->desc.fragShader) != shaderPaths.end();
+                if (!uses) continue;
+                if (e->state == State::Failed) e->state = State::Pending;
+                queue.push_back(key);
+                count++;
+            }
+        }
+        queueCv.notify_all();
+        return count;
+    }
+
+    //写回磁盘（析构时也会自动调用）；先写临时文件再改名，写到一半退出也不会留下坏文件
+    void save() const
+    {
+        if (cachePath.empty()) return;
+        auto data = (*device)->getPipelineCacheData(*cache);
+        std::string tmpPath = cachePath + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return;
+            file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, cachePath, ec);
+    }
+
+    vk::PipelineCache pipelineCache() const { return *cache; }
+    uint32_t pipelineCount() const { std::lock_guard<std::mutex> lock(mutex); return (uint32_t)entries.size(); }
+    bool loadedFromDisk() const { return cacheLoaded; }
+
+private:
+    enum class State { Pending, Ready, Failed };
+
+    struct Entry {
+        PipelineDesc desc;
+        uint64_t fallback = 0;
+        State state = State::Pending;
+        vk::UniquePipeline pipeline;
+    };
+
+    //磁盘缓存只有在 vendor/device/pipelineCacheUUID 都和当前设备一致时才用，否则当作空缓存
+    std::vector<char> loadCacheFile()
+    {
+        if (cachePath.empty()) return {};
+        std::ifstream file(cachePath, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) return {};
+        std::vector<char> data((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+
+        VkPipelineCacheHeaderVersionOne header;
+        if (data.size() < sizeof(header)) return {};
+        memcpy(&header, data.data(), sizeof(header));
+        if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            || header.vendorID != properties.vendorID
+            || header.deviceID != properties.deviceID
+            || memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0) {
+            std::cout << "[pipeline] cache file does not match this device, ignored" << std::endl;
+            return {};
+        }
+        cacheLoaded = true;
+        std::cout << "[pipeline] loaded cache " << data.size() / 1024 << " KB" << std::endl;
+        return data;
+    }
+
+    void workerLoop()
+    {
+        for (;;) {
+            uint64_t key;
+            const PipelineDesc* desc;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queueCv.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                key = queue.front();
+                queue.pop_front();
+                desc = &entries.at(key)->desc;   // Entry在unique_ptr里，地址不会变
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            vk::UniquePipeline pipeline;
+            try {
+                pipeline = build(*desc);
+            }
+            catch (const std::exception& e) {
+                std::cout << "[pipeline] " << desc->vertShader << " + " << desc->fragShader << " failed: " << e.what() << std::endl;
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                Entry& e = *entries.at(key);
+                //重建时旧pipeline可能还在GPU上用，先留着，下次 reload() 时再释放；重建失败保留旧的
+                if (pipeline) {
+                    if (e.pipeline) retired.push_back(std::move(e.pipeline));
+                    e.pipeline = std::move(pipeline);
+                    e.state = State::Ready;
+                }
+                else if (!e.pipeline) e.state = State::Failed;
+            }
+            readyCv.notify_all();
+            std::cout << "[pipeline] " << std::hex << key << std::dec << " compiled in " << ms << " ms" << std::endl;
+        }
+    }
+
+    //VkPipelineCache自带同步，多个线程可以同时用它创建pipeline
+    vk::UniquePipeline build(const PipelineDesc& desc) const
+    {
+        PROFILE_SCOPE("PipelineManager::build");
+        //shader module只在创建期间需要
+        auto vert = shaders->get(desc.vertShader);
+        auto frag = shaders->get(desc.fragShader);
+        vk::UniqueShaderModule vertShader = vert->createModule(*device);
+        vk::UniqueShaderModule fragShader = frag->createModule(*device);
+        std::array<vk::PipelineShaderStageCreateInfo, 2> stages = {
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, *vertShader, vert->reflection.entryPoint.c_str()),
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, *fragShader, frag->reflection.entryPoint.c_str())
+        };
+
+        vk::PipelineVertexInputStateCreateInfo vertexInput({}, desc.bindings, desc.attributes);
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, desc.topology);
+        vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);  // 数量固定，具体值录制时设置
+        vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false, vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack, vk::FrontFace::eClockwise, false, 0.0f, 0.0f, 0.0f, 1.0f);
+        vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
+
+        vk::PipelineColorBlendAttachmentState blendState(desc.blend != BlendMode::Opaque);
+        blendState.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        blendState.dstColorBlendFactor = desc.blend == BlendMode::Additive ? vk::BlendFactor::eOne : vk::BlendFactor::eOneMinusSrcAlpha;
+        blendState.colorBlendOp = vk::BlendOp::eAdd;
+        blendState.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+        blendState.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        blendState.alphaBlendOp = vk::BlendOp::eAdd;
+        blendState.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy, 1, &blendState);
+
+        std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+        vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates);
+
+        vk::GraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.setStages(stages);
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 0;
+
+        return std::move((*device)->createGraphicsPipelineUnique(*cache, pipelineInfo).value);
+    }
+
+    const vk::UniqueDevice* device;
+    vk::RenderPass renderPass;
+    vk::PipelineLayout pipelineLayout;
+    ShaderLibrary* shaders;
+    std::string cachePath;
+    vk::PhysicalDeviceProperties properties;
+    vk::UniquePipelineCache cache;
+    bool cacheLoaded = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable queueCv;
+    std::condition_variable readyCv;
+    std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+    std::vector<vk::UniquePipeline> retired;    // 热重载换下来的pipeline
+    std::deque<uint64_t> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
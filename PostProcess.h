@@ -0,0 +1,143 @@
+#pragma once
+#include "RenderGraph.h"
+#include "PipelineManager.h"
+
+//-----------------后处理----------------------
+//泛光（bloom）：亮部提取并缩到半分辨率 -> 横向、纵向两趟高斯模糊 -> 和场景颜色合成，全部是渲染图里的全屏pass
+//全屏pass没有顶点输入（fullscreen.vert 按 gl_VertexIndex 生成一个盖住屏幕的三角形）
+//pipeline layout和场景不同（set 0 是两张采样图），所以用自己的 PipelineManager；
+//图里的pass都是单个颜色附件，和场景的render pass兼容，直接拿它来创建pipeline
+
+//push constant，和 blur.frag / composite.frag 的 Params 一致
+struct PostParams {
+    float direction[2];     // blur：相邻采样点的UV步长，0表示只采样一次（亮部提取）
+    float amount;           // blur：亮度阈值；composite：泛光强度
+    float pad;
+};
+
+class PostProcess {
+public:
+    static constexpr uint32_t MaxPasses = 8;    // 描述符集个数
+
+    PostProcess(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        const vk::UniqueRenderPass& renderPass,
+        ShaderLibrary& shaders,
+        const std::string& pipelineCachePath)
+        : device(&device)
+    {
+        //描述符布局来自shader反射：binding 0 是输入，binding 1 是合成时的泛光
+        auto vert = shaders.get("Shader/fullscreen.vert");
+        auto blur = shaders.get("Shader/blur.frag");
+        auto composite = shaders.get("Shader/composite.frag");
+        if (blur->reflection.pushConstantSize != sizeof(PostParams) || composite->reflection.pushConstantSize != sizeof(PostParams))
+            throw std::runtime_error("post-process shaders: push constants do not match PostParams");
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = MakeSetLayoutBindings({ vert.get(), blur.get(), composite.get() }, 0);
+        if (bindings.size() != 2) throw std::runtime_error("post-process shaders: expected 2 samplers in set 0");
+        setLayout = device->createDescriptorSetLayoutUnique({ {}, bindings });
+        vk::PushConstantRange pushRange(vk::ShaderStageFlagBits::eFragment, 0, sizeof(PostParams));
+        pipelineLayout = device->createPipelineLayoutUnique({ {}, 1, &*setLayout, 1, &pushRange });
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, 2 * MaxPasses);
+        descriptorPool = device->createDescriptorPoolUnique({ {}, MaxPasses, 1, &poolSize });
+        std::vector<vk::DescriptorSetLayout> layouts(MaxPasses, *setLayout);
+        sets = device->allocateDescriptorSets({ *descriptorPool, layouts });
+
+        vk::SamplerCreateInfo samplerInfo({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+            vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge);
+        sampler = device->createSamplerUnique(samplerInfo);
+
+        //磁盘缓存和场景的分开存（两个管理器不能写同一个文件）
+        pipelines = std::make_unique<PipelineManager>(device, physicalDevice, renderPass, *pipelineLayout, shaders,
+            pipelineCachePath.empty() ? "" : pipelineCachePath + ".post", 1);
+        PipelineDesc desc;
+        desc.vertShader = "Shader/fullscreen.vert";
+        desc.fragShader = "Shader/blur.frag";
+        blurPipeline = pipelines->request(desc);
+        desc.fragShader = "Shader/composite.frag";
+        compositePipeline = pipelines->request(desc);
+        //合成没编好时swapchain图片就没有内容，启动时等它们编好
+        pipelines->wait(blurPipeline);
+        pipelines->wait(compositePipeline);
+    }
+
+    //在图里声明泛光的pass：sceneColor -> target
+    //bloom为false时合成只读场景颜色，亮部提取和模糊的pass照常声明，但结果没人用，compile时被剔除
+    void addPasses(RenderGraph& graph, RGTexture sceneColor, RGTexture target, bool bloom, float threshold = 0.5f, float strength = 1.5f)
+    {
+        passes.clear();
+        vk::Extent2D full = graph.extent(sceneColor);
+        vk::Extent2D half(std::max(full.width / 2, 1u), std::max(full.height / 2, 1u));
+        vk::Format format = graph.format(sceneColor);
+        //bright 和 blurY 的生命周期不重叠，compile时共用一段内存
+        RGTexture bright = graph.createTexture("bloom bright", half, format);
+        RGTexture blurX = graph.createTexture("bloom blur x", half, format);
+        RGTexture blurY = graph.createTexture("bloom blur y", half, format);
+        float dx = 1.0f / half.width, dy = 1.0f / half.height;
+        addFullscreen(graph, "bloom bright", blurPipeline, sceneColor, sceneColor, bright, { { 0.0f, 0.0f }, threshold, 0.0f });
+        addFullscreen(graph, "bloom blur x", blurPipeline, bright, bright, blurX, { { dx, 0.0f }, 0.0f, 0.0f });
+        addFullscreen(graph, "bloom blur y", blurPipeline, blurX, blurX, blurY, { { 0.0f, dy }, 0.0f, 0.0f });
+        addFullscreen(graph, "composite", compositePipeline, sceneColor, bloom ? blurY : sceneColor, target,
+            { { 0.0f, 0.0f }, bloom ? strength : 0.0f, 0.0f });
+    }
+
+    //graph.compile() 之后、GPU空闲时调用：把各pass的输入写进描述符（重新compile之前view不变）
+    //被剔除的pass输入没有创建，跳过
+    void bind(const RenderGraph& graph)
+    {
+        for (const FullscreenPass& p : passes) {
+            std::array<vk::DescriptorImageInfo, 2> infos;
+            bool complete = true;
+            for (uint32_t i = 0; i < 2; ++i) {
+                infos[i] = vk::DescriptorImageInfo(*sampler, graph.view(p.inputs[i]), vk::ImageLayout::eShaderReadOnlyOptimal);
+                complete &= (bool)infos[i].imageView;
+            }
+            if (!complete) continue;
+            std::array<vk::WriteDescriptorSet, 2> writes;
+            for (uint32_t i = 0; i < 2; ++i)
+                writes[i] = vk::WriteDescriptorSet(p.set, i, 0, 1, vk::DescriptorType::eCombinedImageSampler, &infos[i]);
+            (*device)->updateDescriptorSets(writes, nullptr);
+        }
+    }
+
+    //shader热重载（调用前GPU要空闲）
+    void reload(const std::vector<std::string>& shaderPaths) { pipelines->reload(shaderPaths); }
+
+private:
+    struct FullscreenPass {
+        std::array<RGTexture, 2> inputs;
+        vk::DescriptorSet set;
+    };
+
+    void addFullscreen(RenderGraph& graph, const char* name, uint64_t pipeline, RGTexture input0, RGTexture input1, RGTexture output,
+        const PostParams& params)
+    {
+        uint32_t index = (uint32_t)passes.size();
+        if (index >= MaxPasses) throw std::runtime_error("PostProcess: too many passes");
+        passes.push_back({ { input0, input1 }, sets[index] });
+        auto builder = graph.addPass(name, [this, pipeline, index, params](const RGContext& ctx) {
+            vk::Pipeline p = pipelines->get(pipeline);
+            if (!p) return;
+            ctx.cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, p);
+            ctx.cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout, 0, passes[index].set, nullptr);
+            ctx.cmd.pushConstants<PostParams>(*pipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, params);
+            ctx.cmd.draw(3, 1, 0, 0);
+        });
+        builder.sample(input0);
+        if (input1 != input0) builder.sample(input1);
+        //全屏覆盖，之前的内容不要
+        builder.write(output, vk::AttachmentLoadOp::eDontCare);
+    }
+
+    const vk::UniqueDevice* device;
+    vk::UniqueDescriptorSetLayout setLayout;
+    vk::UniquePipelineLayout pipelineLayout;
+    vk::UniqueDescriptorPool descriptorPool;
+    std::vector<vk::DescriptorSet> sets;    // 随pool释放
+    vk::UniqueSampler sampler;
+    std::unique_ptr<PipelineManager> pipelines;
+    uint64_t blurPipeline = 0;
+    uint64_t compositePipeline = 0;
+    std::vector<FullscreenPass> passes;
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include "Tools.h"
+#include "FrameSync.h"
+#include <algorithm>
+
+//-----------------呈现（Present）----------------------
+//按延迟/功耗策略选择present mode和图片数量；窗口大小变化、最小化、OutOfDate/Suboptimal时就地重建swapchain，
+//旧swapchain作为oldSwapchain交给驱动，它的图片、framebuffer和信号量等在飞的帧都结束后再销毁，不用waitIdle
+//同时统计 acquire到present 的耗时和两次present之间的间隔（帧节奏）
+
+//present策略
+enum class PresentPolicy {
+    LowLatency,     // MAILBOX > IMMEDIATE > FIFO：延迟最低，允许撕裂
+    Balanced,       // MAILBOX > FIFO：不撕裂，尽量低延迟
+    PowerSaving     // FIFO：跟随垂直同步，GPU不会多画被丢掉的帧
+};
+
+PresentPolicy ParsePresentPolicy(const std::string& name)
+{
+    if (name == "low-latency") return PresentPolicy::LowLatency;
+    if (name == "balanced") return PresentPolicy::Balanced;
+    if (name == "power") return PresentPolicy::PowerSaving;
+    throw std::runtime_error("unknown present policy: " + name);
+}
+
+//FIFO是规范保证一定支持的
+vk::PresentModeKHR ChoosePresentMode(const std::vector<vk::PresentModeKHR>& available, PresentPolicy policy)
+{
+    std::vector<vk::PresentModeKHR> preferred;
+    switch (policy) {
+    case PresentPolicy::LowLatency:
+        preferred = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+        break;
+    case PresentPolicy::Balanced:
+        preferred = { vk::PresentModeKHR::eMailbox };
+        break;
+    case PresentPolicy::PowerSaving:
+        break;
+    }
+    for (auto mode : preferred) {
+        if (std::find(available.begin(), available.end(), mode) != available.end()) return mode;
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+//MAILBOX至少3张（总有一张空闲可画，不会阻塞在acquire上）；IMMEDIATE和低延迟的FIFO用最少的图片，
+//排队的图片越少，画面越新；省电模式多一张，换取更稳的帧节奏
+uint32_t ChooseImageCount(const vk::SurfaceCapabilitiesKHR& capabilities, vk::PresentModeKHR mode, PresentPolicy policy)
+{
+    uint32_t count = capabilities.minImageCount;
+    if (mode == vk::PresentModeKHR::eMailbox) count = std::max(capabilities.minImageCount + 1, 3u);
+    else if (mode == vk::PresentModeKHR::eImmediate) count = std::max(capabilities.minImageCount, 2u);
+    else if (policy == PresentPolicy::PowerSaving) count = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount > 0) count = std::min(count, capabilities.maxImageCount);
+    return count;
+}
+
+//currentExtent为0xFFFFFFFF时表示由swapchain决定，用窗口的framebuffer大小并限制在允许范围内
+vk::Extent2D ChooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities, GLFWwindow* window)
+{
+    if (capabilities.currentExtent.width != UINT32_MAX) return capabilities.currentExtent;
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    return vk::Extent2D(
+        std::clamp((uint32_t)width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
+        std::clamp((uint32_t)height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height));
+}
+
+class Presenter {
+public:
+    //会填好 sync 里按图片分配的部分（renderFinished、imagesInFlight）
+    Presenter(
+        const vk::UniqueDevice& device,
+        const vk::PhysicalDevice& physicalDevice,
+        vk::SurfaceKHR surface,
+        GLFWwindow* window,
+        const vk::SurfaceFormatKHR& surfaceFormat,
+        const vk::UniqueRenderPass& renderPass,
+        PresentPolicy policy,
+        FrameSync& sync)
+        : device(&device), physicalDevice(physicalDevice), surface(surface), window(window),
+          surfaceFormat(surfaceFormat), renderPass(&renderPass), policy(policy), sync(&sync)
+    {
+        presentMode = ChoosePresentMode(physicalDevice.getSurfacePresentModesKHR(surface), policy);
+        glfwSetWindowUserPointer(window, this);
+        glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) {
+            static_cast<Presenter*>(glfwGetWindowUserPointer(w))->resized = true;
+        });
+        create({});
+        std::cout << "[present] mode " << vk::to_string(presentMode) << ", images " << framebuffers.size()
+            << ", extent " << extent.width << "x" << extent.height << std::endl;
+    }
+
+    Presenter(const Presenter&) = delete;
+    Presenter& operator=(const Presenter&) = delete;
+
+    //在 WaitForFrame 之后调用。swapchain过期时就地重建并返回空，调用者跳过这一帧
+    std::optional<uint32_t> acquire()
+    {
+        releaseRetired();
+        acquireStart = std::chrono::steady_clock::now();
+        PROFILE_SCOPE("acquireNextImageKHR");
+        vk::ResultValue<uint32_t> result(vk::Result::eErrorOutOfDateKHR, 0);
+        try {
+            result = (*device)->acquireNextImageKHR(*swapchain, UINT64_MAX, *sync->imageAvailable[sync->currentFrame]);
+        }
+        catch (const vk::OutOfDateKHRError&) {
+            recreate();
+            return std::nullopt;
+        }
+        //Suboptimal时信号量已经signal，这一帧照常画完、present之后再重建
+        if (result.result == vk::Result::eSuboptimalKHR) needsRecreate = true;
+        return result.value;
+    }
+
+    //present，并在需要时重建swapchain
+    void present(vk::Queue queue, uint32_t imageIndex)
+    {
+        vk::PresentInfoKHR presentInfo(1, &*sync->renderFinished[imageIndex], 1, &*swapchain, &imageIndex);
+        try {
+            PROFILE_SCOPE("presentKHR");
+            if (queue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) needsRecreate = true;
+        }
+        catch (const vk::OutOfDateKHRError&) {
+            needsRecreate = true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        acquireToPresent.add(std::chrono::duration<double, std::milli>(now - acquireStart).count());
+        if (presentCount > 0) framePacing.add(std::chrono::duration<double, std::milli>(now - lastPresent).count());
+        lastPresent = now;
+        presentCount++;
+
+        if (needsRecreate || resized) recreate();
+    }
+
+    //输出并清空直方图（和帧统计一起每秒一次）
+    void report()
+    {
+        std::cout << "[present] " << vk::to_string(presentMode) << " " << extent.width << "x" << extent.height
+            << ", acquire->present " << acquireToPresent.summary()
+            << ", pacing " << framePacing.summary()
+            << ", recreated " << recreateCount << "x" << std::endl;
+        acquireToPresent.reset();
+        framePacing.reset();
+    }
+
+    const vk::UniqueFramebuffer& framebuffer(uint32_t imageIndex) const { return framebuffers[imageIndex]; }
+    vk::Image image(uint32_t imageIndex) const { return images[imageIndex]; }
+    vk::ImageView view(uint32_t imageIndex) const { return *imageViews[imageIndex]; }
+    const vk::Extent2D& currentExtent() const { return extent; }
+    uint32_t imageCount() const { return (uint32_t)framebuffers.size(); }
+    vk::PresentModeKHR mode() const { return presentMode; }
+    //每次重建加一：图片换了一套，之前按图片记的状态（比如脏矩形）都要作废
+    uint32_t generation() const { return recreateCount; }
+    //窗口大小变了、还没重建（主循环空闲阻塞时用它决定要不要画一帧来触发重建）
+    bool resizePending() const { return resized; }
+
+private:
+    //被替换下来的swapchain：成员声明顺序保证先销毁framebuffer和view，最后销毁swapchain
+    struct Retired {
+        vk::UniqueSwapchainKHR swapchain;
+        std::vector<vk::UniqueImageView> imageViews;
+        std::vector<vk::UniqueFramebuffer> framebuffers;
+        std::vector<vk::UniqueSemaphore> renderFinished;
+        uint64_t releaseAt;
+    };
+
+    void create(vk::SwapchainKHR oldSwapchain)
+    {
+        vk::SurfaceCapabilitiesKHR capabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
+        extent = ChooseExtent(capabilities, window);
+        uint32_t imageCount = ChooseImageCount(capabilities, presentMode, policy);
+        swapchain = InitSwapChain(physicalDevice, device, surface, capabilities, surfaceFormat, extent, presentMode, imageCount, oldSwapchain);
+        images = (*device)->getSwapchainImagesKHR(*swapchain);
+        imageViews = InitImageViews(*device, swapchain, surfaceFormat);
+        framebuffers = InitFrameBuffer(imageViews, *renderPass, extent, *device);
+
+        //驱动实际给的图片数可能比要求的多
+        sync->renderFinished.clear();
+        for (size_t i = 0; i < framebuffers.size(); ++i)
+            sync->renderFinished.push_back((*device)->createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+        sync->imagesInFlight.assign(framebuffers.size(), nullptr);
+    }
+
+    //最小化时framebuffer为0，阻塞等窗口恢复（或者关闭）
+    void recreate()
+    {
+        PROFILE_SCOPE("Presenter::recreate");
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        while ((width == 0 || height == 0) && !glfwWindowShouldClose(window)) {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(window, &width, &height);
+        }
+        if (width == 0 || height == 0) return;
+
+        //旧的一套要等到此刻之前提交的帧都完成：再经过framesInFlight次WaitForFrame即可
+        retired.push_back({ std::move(swapchain), std::move(imageViews), std::move(framebuffers), std::move(sync->renderFinished),
+            presentCount + sync->framesInFlight });
+        create(*retired.back().swapchain);
+        needsRecreate = false;
+        resized = false;
+        recreateCount++;
+    }
+
+    void releaseRetired()
+    {
+        while (!retired.empty() && retired.front().releaseAt <= presentCount) retired.erase(retired.begin());
+    }
+
+    const vk::UniqueDevice* device;
+    vk::PhysicalDevice physicalDevice;
+    vk::SurfaceKHR surface;
+    GLFWwindow* window;
+    vk::SurfaceFormatKHR surfaceFormat;
+    const vk::UniqueRenderPass* renderPass;
+    PresentPolicy policy;
+    FrameSync* sync;
+    vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+
+    vk::UniqueSwapchainKHR swapchain;
+    std::vector<vk::Image> images;      // 属于swapchain，不用单独释放
+    std::vector<vk::UniqueImageView> imageViews;
+    std::vector<vk::UniqueFramebuffer> framebuffers;
+    vk::Extent2D extent;
+    std::vector<Retired> retired;
+
+    bool resized = false;
+    bool needsRecreate = false;
+    uint64_t presentCount = 0;
+    uint32_t recreateCount = 0;
+    std::chrono::steady_clock::time_point acquireStart;
+    std::chrono::steady_clock::time_point lastPresent;
+    LatencyHistogram acquireToPresent;
+    LatencyHistogram framePacing;
+};
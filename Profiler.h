@@ -0,0 +1,252 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_set>
+
+//-----------------性能分析（CPU部分）----------------------
+//PROFILE_SCOPE("名字") 记录所在作用域的起止时间。每个线程写自己的定长缓冲：只有线程第一次记录时加锁注册，
+//之后的记录不加锁（单写者，用原子计数发布）。缓冲写满后丢弃新事件并计数
+//GPU时间戳见 GpuProfiler.h，解析后也汇总到这里，一起导出成 Chrome trace JSON（chrome://tracing 或 Perfetto 打开）
+//没有开启（--profile）时，作用域只读一次原子开关
+
+//固定桶宽的毫秒直方图，超出范围的计入最后一个桶
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(double bucketMs = 0.25, uint32_t bucketCount = 400)
+        : bucketMs(bucketMs), buckets(bucketCount, 0) {}
+
+    void add(double ms)
+    {
+        size_t index = std::min((size_t)(std::max(ms, 0.0) / bucketMs), buckets.size() - 1);
+        buckets[index]++;
+        samples++;
+        maxMs = std::max(maxMs, ms);
+    }
+
+    //p in [0,1]，返回所在桶的上沿
+    double percentile(double p) const
+    {
+        if (samples == 0) return 0.0;
+        uint64_t target = (uint64_t)std::ceil(p * samples);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= target) return std::min((i + 1) * bucketMs, maxMs);
+        }
+        return maxMs;
+    }
+
+    std::string summary() const
+    {
+        std::ostringstream out;
+        out << "p50 " << percentile(0.5) << " / p90 " << percentile(0.9) << " / p99 " << percentile(0.99)
+            << " / max " << maxMs << " ms";
+        return out.str();
+    }
+
+    uint64_t count() const { return samples; }
+
+    void reset()
+    {
+        std::fill(buckets.begin(), buckets.end(), 0);
+        samples = 0;
+        maxMs = 0.0;
+    }
+
+private:
+    double bucketMs;
+    std::vector<uint64_t> buckets;
+    uint64_t samples = 0;
+    double maxMs = 0.0;
+};
+
+//运行时拼出来的名字（例如渲染图的pass名）换成一直有效到程序结束的指针，才能交给只存指针的记录函数
+const char* InternProfileName(const std::string& name)
+{
+    static std::mutex mutex;
+    static std::unordered_set<std::string> names;   // 节点不会移动，c_str()一直有效
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.insert(name).first->c_str();
+}
+
+//JSON字符串字面量（带引号）：转义引号、反斜杠和控制字符
+std::string JsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+            out += escaped;
+        }
+        else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+class Profiler {
+public:
+    //name必须是静态字符串（字面量或 InternProfileName 的结果），记录时只存指针
+    struct Event {
+        const char* name;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    static constexpr uint32_t EventsPerThread = 1u << 18;
+
+    Profiler() : epoch(std::chrono::steady_clock::now()) {}
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    //距离程序启动的纳秒数，CPU和GPU事件共用这条时间轴
+    uint64_t now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    //任意线程调用
+    void record(const char* name, uint64_t startNs, uint64_t endNs)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        uint32_t n = buffer.count.load(std::memory_order_relaxed);
+        if (n == EventsPerThread) {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[n] = { name, startNs, endNs };
+        buffer.count.store(n + 1, std::memory_order_release);
+    }
+
+    //GPU时间段（已换算到CPU时间轴），只在主线程调用
+    void recordGpu(const char* name, uint64_t startNs, uint64_t endNs)
+    {
+        if (gpuEvents.size() < EventsPerThread) gpuEvents.push_back({ name, startNs, endNs });
+    }
+
+    //每帧一次：CPU帧时间进直方图，report()时输出p50/p99（不需要开启--profile）
+    void endFrame(double frameMs) { frameTimes.add(frameMs); }
+
+    void report()
+    {
+        std::cout << "[profile] frame " << frameTimes.summary() << std::endl;
+        frameTimes.reset();
+    }
+
+    //可以在其他线程还在记录时调用，只导出已经发布的事件
+    bool writeChromeTrace(const std::string& path)
+    {
+        std::ofstream file(path);
+        if (!file.is_open()) return false;
+
+        uint64_t dropped = 0;
+        bool first = true;
+        auto writeEvent = [&](const Event& e, uint32_t pid, uint32_t tid) {
+            file << (first ? "\n" : ",\n") << "{\"name\":" << JsonString(e.name) << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"ts\":" << e.startNs / 1000.0 << ",\"dur\":" << (e.endNs - e.startNs) / 1000.0 << "}";
+            first = false;
+        };
+        auto writeName = [&](uint32_t pid, uint32_t tid, const std::string& name) {
+            file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"args\":{\"name\":" << JsonString(name) << "}}";
+            first = false;
+        };
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        {
+            std::lock_guard<std::mutex> lock(registerMutex);
+            for (uint32_t t = 0; t < buffers.size(); ++t) {
+                const ThreadBuffer& buffer = *buffers[t];
+                writeName(1, t, t == 0 ? "main" : "thread " + std::to_string(t));
+                uint32_t n = buffer.count.load(std::memory_order_acquire);
+                for (uint32_t i = 0; i < n; ++i) writeEvent(buffer.events[i], 1, t);
+                dropped += buffer.dropped.load(std::memory_order_relaxed);
+            }
+        }
+        writeName(2, 0, "gpu queue");
+        for (const Event& e : gpuEvents) writeEvent(e, 2, 0);
+        file << "\n]}\n";
+
+        std::cout << "[profile] trace written to " << path;
+        if (dropped) std::cout << " (" << dropped << " events dropped)";
+        std::cout << std::endl;
+        return true;
+    }
+
+private:
+    struct ThreadBuffer {
+        std::unique_ptr<Event[]> events{ new Event[EventsPerThread] };
+        std::atomic<uint32_t> count{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    //缓冲在线程退出后保留，导出时还能读到
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(registerMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    std::chrono::steady_clock::time_point epoch;
+    std::atomic<bool> enabled{ false };
+    std::mutex registerMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<Event> gpuEvents;
+    LatencyHistogram frameTimes{ 0.1, 1000 };
+};
+
+//全局只有一个分析器（thread_local缓冲按线程区分，不按分析器实例区分）
+Profiler& GetProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name(name), active(GetProfiler().isEnabled()), startNs(active ? GetProfiler().now() : 0) {}
+
+    ~ProfileScope()
+    {
+        if (active) GetProfiler().record(name, startNs, GetProfiler().now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t startNs;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
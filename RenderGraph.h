@@ -0,0 +1,707 @@
+#pragma once
+#include "Memory.h"
+#include "GpuProfiler.h"
+#include <functional>
+#include <map>
+#include <algorithm>
+#include <string>
+
+//-----------------渲染图----------------------
+//每个pass声明它读写哪些图片，compile() 据此：
+//  1. 从输出（导入的图片、标了sideEffect的pass）往回找，剔除结果没人用的pass
+//  2. 按依赖排序：生产者之后尽量紧跟它的消费者，临时附件的生命周期更短
+//  3. 临时附件由图自己创建，生命周期（第一次到最后一次使用）不重叠的共用同一段内存
+//  4. 预先算好每个pass之前的barrier：布局不变的读->读不插，同一个pass的barrier合并成一次调用
+//execute() 按顺序录制：有颜色附件的pass由图开始/结束render pass，其余pass（拷贝等）在render pass外录制
+//图只跟踪图片，buffer的同步（比如GPU剔除）仍由各自的模块负责
+//声明、compile一次（窗口大小变化时重来），之后每帧 setImported + execute
+
+using RGTexture = uint32_t;
+
+//pass对图片的用法
+enum class RGUsage : uint8_t {
+    ColorAttachment,    // 颜色附件（写）
+    Sampled,            // 片元shader采样（读）
+    TransferSrc,        // 拷贝源（读）
+    TransferDst         // 拷贝目标（写，保留没拷到的部分）
+};
+
+struct RenderGraphStats {
+    uint32_t passes = 0;                        // 声明的pass
+    uint32_t culledPasses = 0;                  // 结果没人用、被剔除的
+    uint32_t transients = 0;                    // 用到的临时附件
+    uint32_t allocations = 0;                   // 别名之后实际分配的内存段
+    vk::DeviceSize bytesWithoutAliasing = 0;    // 每个临时附件各占一段时的总大小
+    vk::DeviceSize bytesAllocated = 0;          // 别名之后实际分配的总大小
+    uint32_t barriers = 0;                      // 每帧插入的图片barrier
+    uint32_t barrierBatches = 0;                // 合并成的 vkCmdPipelineBarrier 调用
+    uint32_t naiveBarriers = 0;                 // 每次访问都单独转换一次时的barrier数
+};
+
+class RenderGraph;
+
+//pass录制时拿到的参数
+struct RGContext {
+    vk::CommandBuffer cmd;
+    vk::Extent2D extent;        // 颜色附件的大小（没有颜色附件的pass为0）
+    uint32_t frame;             // execute() 传进来的每帧资源下标
+    const RenderGraph* graph;   // 查图片和view
+};
+
+class RenderGraph {
+public:
+    using ExecuteFn = std::function<void(const RGContext&)>;
+    static constexpr uint32_t None = UINT32_MAX;
+
+    RenderGraph(const vk::UniqueDevice& device, GpuAllocator& allocator)
+        : device(&device), allocator(&allocator)
+    {
+    }
+
+    ~RenderGraph() { releaseResources(); }
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    //声明pass用到的图片（链式调用）
+    class PassBuilder {
+    public:
+        //写颜色附件；eLoad保留之前的内容（依赖之前写它的pass），eClear/eDontCare时之前的内容直接丢掉
+        PassBuilder& write(RGTexture texture, vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eClear,
+            const std::array<float, 4>& clearColor = { 0.0f, 0.0f, 0.0f, 1.0f })
+        {
+            return add(texture, RGUsage::ColorAttachment, loadOp, clearColor);
+        }
+        PassBuilder& sample(RGTexture texture) { return add(texture, RGUsage::Sampled); }
+        PassBuilder& copyFrom(RGTexture texture) { return add(texture, RGUsage::TransferSrc); }
+        PassBuilder& copyTo(RGTexture texture) { return add(texture, RGUsage::TransferDst); }
+        //有图片之外的副作用（写buffer、读回等），不会被剔除
+        PassBuilder& sideEffect()
+        {
+            graph->passes[pass].sideEffect = true;
+            return *this;
+        }
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph* graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        PassBuilder& add(RGTexture texture, RGUsage usage, vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eLoad,
+            const std::array<float, 4>& clearColor = {})
+        {
+            Pass& p = graph->passes[pass];
+            if (texture >= graph->textures.size()) throw std::runtime_error("render graph: pass '" + p.name + "' uses an unknown texture");
+            //同一个pass里读写同一张图（反馈回路）不支持
+            for (const Access& a : p.accesses) {
+                if (a.texture == texture)
+                    throw std::runtime_error("render graph: pass '" + p.name + "' uses '" + graph->textures[texture].name + "' twice");
+            }
+            p.accesses.push_back({ texture, usage, loadOp, vk::ClearColorValue(clearColor) });
+            return *this;
+        }
+
+        RenderGraph* graph;
+        uint32_t pass;
+    };
+
+    //临时附件：内容只在这一帧的pass之间传递，compile时创建（没人用就不创建）
+    RGTexture createTexture(const std::string& name, vk::Extent2D extent, vk::Format format)
+    {
+        Texture t;
+        t.name = name;
+        t.extent = extent;
+        t.format = format;
+        textures.push_back(std::move(t));
+        return (RGTexture)textures.size() - 1;
+    }
+
+    //外部图片（比如swapchain图片），每帧用 setImported 给出实际的图片；写它的pass不会被剔除
+    //每帧交进来时是initialLayout，外部同步（acquire的信号量）在waitStage等待；执行完转到finalLayout
+    RGTexture importTexture(
+        const std::string& name,
+        vk::Extent2D extent,
+        vk::Format format,
+        vk::ImageLayout initialLayout,
+        vk::ImageLayout finalLayout,
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput)
+    {
+        RGTexture t = createTexture(name, extent, format);
+        textures[t].imported = true;
+        textures[t].initialLayout = initialLayout;
+        textures[t].finalLayout = finalLayout;
+        textures[t].waitStage = waitStage;
+        return t;
+    }
+
+    PassBuilder addPass(const std::string& name, ExecuteFn execute)
+    {
+        Pass p;
+        p.name = name;
+        p.profileName = InternProfileName(name);
+        p.execute = std::move(execute);
+        passes.push_back(std::move(p));
+        return PassBuilder(this, (uint32_t)passes.size() - 1);
+    }
+
+    //清空声明和compile的结果（调用前GPU要空闲）
+    void reset()
+    {
+        releaseResources();
+        passes.clear();
+        textures.clear();
+        order.clear();
+        statistics = {};
+    }
+
+    void compile()
+    {
+        PROFILE_SCOPE("RenderGraph::compile");
+        releaseResources();
+        statistics = {};
+        statistics.passes = (uint32_t)passes.size();
+
+        std::vector<std::vector<uint32_t>> dataDeps, orderDeps;
+        findDependencies(dataDeps, orderDeps);
+        cull(dataDeps);
+        schedule(dataDeps, orderDeps);
+        allocateTransients();
+        planBarriers();
+        createRenderPasses();
+    }
+
+    //导入图片这一帧实际的图片和view
+    void setImported(RGTexture texture, vk::Image image, vk::ImageView view)
+    {
+        textures[texture].image = image;
+        textures[texture].view = view;
+    }
+
+    //按compile排好的顺序录制（必须在render pass之外）
+    void execute(vk::CommandBuffer cmd, GpuProfiler* gpuProfiler = nullptr, uint32_t frame = 0)
+    {
+        PROFILE_SCOPE("RenderGraph::execute");
+        for (uint32_t index : order) {
+            Pass& p = passes[index];
+            if (!p.barriers.empty()) recordBarriers(cmd, p.barriers, p.srcStages, p.dstStages);
+
+            uint32_t zone = gpuProfiler ? gpuProfiler->begin(cmd, frame, p.profileName) : GpuProfiler::NoZone;
+            RGContext ctx = { cmd, p.extent, frame, this };
+            if (p.renderPass) {
+                vk::RenderPassBeginInfo rpBegin(*p.renderPass, framebuffer(p), { {0,0}, p.extent }, p.clears);
+                cmd.beginRenderPass(rpBegin, vk::SubpassContents::eInline);
+                cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, (float)p.extent.width, (float)p.extent.height, 0.0f, 1.0f));
+                cmd.setScissor(0, vk::Rect2D({ 0, 0 }, p.extent));
+                p.execute(ctx);
+                cmd.endRenderPass();
+            }
+            else {
+                p.execute(ctx);
+            }
+            if (gpuProfiler) gpuProfiler->end(cmd, frame, zone);
+        }
+        if (!finalBarriers.empty()) recordBarriers(cmd, finalBarriers, finalSrcStages, vk::PipelineStageFlagBits::eBottomOfPipe);
+    }
+
+    //compile之后可用；没被用到（没有创建）的临时附件返回空
+    vk::Image image(RGTexture texture) const { return textures[texture].image; }
+    vk::ImageView view(RGTexture texture) const { return textures[texture].view; }
+    const vk::Extent2D& extent(RGTexture texture) const { return textures[texture].extent; }
+    vk::Format format(RGTexture texture) const { return textures[texture].format; }
+    const RenderGraphStats& stats() const { return statistics; }
+
+    //执行顺序（不含被剔除的pass）
+    std::vector<std::string> orderedPassNames() const
+    {
+        std::vector<std::string> names;
+        for (uint32_t index : order) names.push_back(passes[index].name);
+        return names;
+    }
+
+private:
+    struct Access {
+        RGTexture texture;
+        RGUsage usage;
+        vk::AttachmentLoadOp loadOp;
+        vk::ClearColorValue clearColor;
+    };
+
+    struct Barrier {
+        RGTexture texture;
+        vk::ImageMemoryBarrier barrier;     // image在execute时按这一帧的实际图片填
+    };
+
+    struct Pass {
+        std::string name;
+        const char* profileName = nullptr;  // GPU时间戳在图reset之后才解析，不能用name.c_str()
+        ExecuteFn execute;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+
+        //compile的结果
+        bool alive = false;
+        std::vector<Barrier> barriers;
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::UniqueRenderPass renderPass;            // 没有颜色附件时为空
+        std::vector<RGTexture> colors;
+        std::vector<vk::ClearValue> clears;
+        vk::Extent2D extent;
+        vk::UniqueFramebuffer framebuffer;          // 只用临时附件时compile时创建
+        std::map<std::vector<VkImageView>, vk::UniqueFramebuffer> importedFramebuffers;    // 用到导入图片时按view缓存
+    };
+
+    struct Texture {
+        std::string name;
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+        bool imported = false;
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags waitStage;
+
+        //compile的结果
+        vk::ImageUsageFlags usage;
+        uint32_t firstUse = None;       // 在order里的下标
+        uint32_t lastUse = None;
+        uint32_t slot = None;           // 内存段
+        uint32_t aliasOf = None;        // 同一段内存里的上一个临时附件
+        vk::UniqueImage ownedImage;
+        vk::UniqueImageView ownedView;
+        vk::Image image;
+        vk::ImageView view;
+    };
+
+    //一段（可能被多个临时附件轮流使用的）内存
+    struct Slot {
+        vk::MemoryRequirements requirements;
+        uint32_t lastUse = 0;
+        uint32_t lastTexture = None;
+        Allocation allocation;
+    };
+
+    //用法对应的布局、阶段和访问
+    struct UsageInfo {
+        vk::ImageLayout layout;
+        vk::PipelineStageFlags stage;
+        vk::AccessFlags access;
+        vk::AccessFlags writeAccess;    // access里的写（没有写就是读）
+        vk::ImageUsageFlags imageUsage;
+    };
+
+    static UsageInfo describe(const Access& a)
+    {
+        switch (a.usage) {
+        case RGUsage::ColorAttachment: {
+            vk::AccessFlags access = vk::AccessFlagBits::eColorAttachmentWrite;
+            if (a.loadOp == vk::AttachmentLoadOp::eLoad) access |= vk::AccessFlagBits::eColorAttachmentRead;
+            return { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                access, vk::AccessFlagBits::eColorAttachmentWrite, vk::ImageUsageFlagBits::eColorAttachment };
+        }
+        case RGUsage::Sampled:
+            return { vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader,
+                vk::AccessFlagBits::eShaderRead, {}, vk::ImageUsageFlagBits::eSampled };
+        case RGUsage::TransferSrc:
+            return { vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer,
+                vk::AccessFlagBits::eTransferRead, {}, vk::ImageUsageFlagBits::eTransferSrc };
+        case RGUsage::TransferDst:
+            return { vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer,
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite, vk::ImageUsageFlagBits::eTransferDst };
+        }
+        throw std::runtime_error("render graph: unknown usage");
+    }
+
+    static bool isWrite(RGUsage usage) { return usage == RGUsage::ColorAttachment || usage == RGUsage::TransferDst; }
+
+    //写的时候要不要之前的内容
+    static bool loadsPrevious(const Access& a)
+    {
+        return a.usage == RGUsage::TransferDst || (a.usage == RGUsage::ColorAttachment && a.loadOp == vk::AttachmentLoadOp::eLoad);
+    }
+
+    //按声明顺序回放访问：dataDeps是真正用到的结果（读、eLoad），orderDeps只约束先后（写之前等之前的读和写）
+    //依赖总是指向先声明的pass，所以不会有环
+    void findDependencies(std::vector<std::vector<uint32_t>>& dataDeps, std::vector<std::vector<uint32_t>>& orderDeps) const
+    {
+        dataDeps.assign(passes.size(), {});
+        orderDeps.assign(passes.size(), {});
+        std::vector<uint32_t> lastWriter(textures.size(), None);
+        std::vector<std::vector<uint32_t>> readersSinceWrite(textures.size());
+        for (uint32_t p = 0; p < passes.size(); ++p) {
+            for (const Access& a : passes[p].accesses) {
+                uint32_t writer = lastWriter[a.texture];
+                if (isWrite(a.usage)) {
+                    if (writer != None) (loadsPrevious(a) ? dataDeps : orderDeps)[p].push_back(writer);
+                    for (uint32_t reader : readersSinceWrite[a.texture]) orderDeps[p].push_back(reader);
+                }
+                else if (writer != None) {
+                    dataDeps[p].push_back(writer);
+                }
+                else if (!textures[a.texture].imported) {
+                    throw std::runtime_error("render graph: pass '" + passes[p].name + "' reads '" + textures[a.texture].name + "' before any pass writes it");
+                }
+            }
+            for (const Access& a : passes[p].accesses) {
+                if (isWrite(a.usage)) {
+                    lastWriter[a.texture] = p;
+                    readersSinceWrite[a.texture].clear();
+                }
+                else {
+                    readersSinceWrite[a.texture].push_back(p);
+                }
+            }
+        }
+    }
+
+    //写导入图片或者有副作用的pass是根，顺着dataDeps往回标记
+    void cull(const std::vector<std::vector<uint32_t>>& dataDeps)
+    {
+        std::vector<uint32_t> stack;
+        for (uint32_t p = 0; p < passes.size(); ++p) {
+            Pass& pass = passes[p];
+            pass.alive = pass.sideEffect;
+            for (const Access& a : pass.accesses) {
+                if (isWrite(a.usage) && textures[a.texture].imported) pass.alive = true;
+            }
+            if (pass.alive) stack.push_back(p);
+        }
+        while (!stack.empty()) {
+            uint32_t p = stack.back();
+            stack.pop_back();
+            for (uint32_t dep : dataDeps[p]) {
+                if (passes[dep].alive) continue;
+                passes[dep].alive = true;
+                stack.push_back(dep);
+            }
+        }
+        for (const Pass& pass : passes) {
+            if (!pass.alive) statistics.culledPasses++;
+        }
+    }
+
+    //拓扑排序：就绪的pass里优先选直接用到上一个pass结果的，其次按声明顺序
+    void schedule(const std::vector<std::vector<uint32_t>>& dataDeps, const std::vector<std::vector<uint32_t>>& orderDeps)
+    {
+        std::vector<uint32_t> remaining(passes.size(), 0);
+        std::vector<std::vector<uint32_t>> users(passes.size());
+        for (uint32_t p = 0; p < passes.size(); ++p) {
+            if (!passes[p].alive) continue;
+            for (const auto* deps : { &dataDeps[p], &orderDeps[p] }) {
+                for (uint32_t dep : *deps) {
+                    if (!passes[dep].alive) continue;
+                    remaining[p]++;
+                    users[dep].push_back(p);
+                }
+            }
+        }
+
+        std::vector<uint32_t> ready;
+        for (uint32_t p = 0; p < passes.size(); ++p) {
+            if (passes[p].alive && remaining[p] == 0) ready.push_back(p);
+        }
+        order.clear();
+        while (!ready.empty()) {
+            size_t best = 0;
+            bool bestFollows = false;
+            for (size_t i = 0; i < ready.size(); ++i) {
+                const auto& deps = dataDeps[ready[i]];
+                bool follows = !order.empty() && std::find(deps.begin(), deps.end(), order.back()) != deps.end();
+                if ((follows && !bestFollows) || (follows == bestFollows && ready[i] < ready[best])) {
+                    best = i;
+                    bestFollows = follows;
+                }
+            }
+            uint32_t p = ready[best];
+            ready.erase(ready.begin() + best);
+            order.push_back(p);
+            for (uint32_t user : users[p]) {
+                if (--remaining[user] == 0) ready.push_back(user);
+            }
+        }
+    }
+
+    //按第一次使用的顺序给临时附件找内存段：上一个使用者已经用完、内存类型兼容的段里挑需要扩得最少的
+    void allocateTransients()
+    {
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            for (const Access& a : passes[order[i]].accesses) {
+                Texture& t = textures[a.texture];
+                if (t.firstUse == None) t.firstUse = i;
+                t.lastUse = i;
+                t.usage |= describe(a).imageUsage;
+            }
+        }
+
+        std::vector<RGTexture> transients;
+        for (RGTexture t = 0; t < textures.size(); ++t) {
+            if (!textures[t].imported && textures[t].firstUse != None) transients.push_back(t);
+        }
+        std::sort(transients.begin(), transients.end(), [&](RGTexture a, RGTexture b) { return textures[a].firstUse < textures[b].firstUse; });
+
+        for (RGTexture index : transients) {
+            Texture& t = textures[index];
+            vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, t.format, vk::Extent3D(t.extent, 1), 1, 1,
+                vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, t.usage);
+            t.ownedImage = (*device)->createImageUnique(imageInfo);
+            t.image = *t.ownedImage;
+            vk::MemoryRequirements req = (*device)->getImageMemoryRequirements(t.image);
+            statistics.bytesWithoutAliasing += req.size;
+
+            uint32_t best = None;
+            vk::DeviceSize bestGrowth = 0;
+            for (uint32_t s = 0; s < slots.size(); ++s) {
+                const Slot& slot = slots[s];
+                if (slot.lastUse >= t.firstUse || !(slot.requirements.memoryTypeBits & req.memoryTypeBits)) continue;
+                vk::DeviceSize growth = req.size > slot.requirements.size ? req.size - slot.requirements.size : 0;
+                if (best == None || growth < bestGrowth || (growth == bestGrowth && slot.requirements.size < slots[best].requirements.size)) {
+                    best = s;
+                    bestGrowth = growth;
+                }
+            }
+            if (best == None) {
+                best = (uint32_t)slots.size();
+                slots.push_back({ req, 0, None, {} });
+            }
+            Slot& slot = slots[best];
+            slot.requirements.size = std::max(slot.requirements.size, req.size);
+            slot.requirements.alignment = std::max(slot.requirements.alignment, req.alignment);
+            slot.requirements.memoryTypeBits &= req.memoryTypeBits;
+            t.slot = best;
+            t.aliasOf = slot.lastTexture;
+            slot.lastTexture = index;
+            slot.lastUse = t.lastUse;
+        }
+
+        for (Slot& slot : slots) {
+            slot.allocation = allocator->allocate(slot.requirements, MemoryUsage::GpuOnly);
+            statistics.bytesAllocated += slot.requirements.size;
+        }
+        for (RGTexture index : transients) {
+            Texture& t = textures[index];
+            (*device)->bindImageMemory(t.image, slots[t.slot].allocation.memory, slots[t.slot].allocation.offset);
+            t.ownedView = (*device)->createImageViewUnique({ {}, t.image, vk::ImageViewType::e2D, t.format, {},
+                { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 } });
+            t.view = *t.ownedView;
+        }
+        statistics.transients = (uint32_t)transients.size();
+        statistics.allocations = (uint32_t)slots.size();
+    }
+
+    //按执行顺序模拟每张图片的状态，只在布局变化或者有未同步的写时插barrier
+    void planBarriers()
+    {
+        struct State {
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags writeStages;     // 最后一次写（导入图片是外部交出它的阶段）
+            vk::AccessFlags writeAccess;
+            vk::PipelineStageFlags readStages;      // 最后一次写之后的读
+            vk::PipelineStageFlags visibleStages;   // 最后一次写已经对哪些阶段可见
+            bool touched = false;
+        };
+        std::vector<State> states(textures.size());
+        std::vector<std::pair<uint32_t, size_t>> firstBarrier(textures.size(), { None, 0 });    // (pass, 下标)
+        for (RGTexture t = 0; t < textures.size(); ++t) {
+            if (!textures[t].imported) continue;
+            states[t].layout = textures[t].initialLayout;
+            states[t].writeStages = textures[t].waitStage;
+        }
+
+        vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+        for (uint32_t index : order) {
+            Pass& p = passes[index];
+            for (const Access& a : p.accesses) {
+                State& s = states[a.texture];
+                const Texture& t = textures[a.texture];
+                //共用内存的临时附件第一次使用：等上一个使用者的读写都结束
+                if (!s.touched && t.aliasOf != None) {
+                    const State& prev = states[t.aliasOf];
+                    s.writeStages = prev.writeStages | prev.readStages;
+                    s.writeAccess = prev.writeAccess;
+                }
+                bool firstTouch = !s.touched;
+                s.touched = true;
+
+                UsageInfo u = describe(a);
+                bool write = isWrite(a.usage);
+                bool layoutChange = s.layout != u.layout;
+                bool needed = write || layoutChange || (s.writeStages && (u.stage & ~s.visibleStages));
+                statistics.naiveBarriers++;
+                if (needed) {
+                    vk::PipelineStageFlags src = s.writeStages;
+                    if (write || layoutChange) src |= s.readStages;
+                    //不需要之前内容的写，旧布局当作未定义，驱动不用保留内容
+                    bool discard = a.usage == RGUsage::ColorAttachment && a.loadOp != vk::AttachmentLoadOp::eLoad;
+                    vk::ImageMemoryBarrier barrier(s.writeAccess, u.access, discard ? vk::ImageLayout::eUndefined : s.layout, u.layout,
+                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, {}, range);
+                    if (firstTouch) firstBarrier[a.texture] = { index, p.barriers.size() };
+                    p.barriers.push_back({ a.texture, barrier });
+                    p.srcStages |= src ? src : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+                    p.dstStages |= u.stage;
+                }
+                s.layout = u.layout;
+                if (write) {
+                    s.writeStages = u.stage;
+                    s.writeAccess = u.writeAccess;
+                    s.readStages = {};
+                    s.visibleStages = {};
+                }
+                else {
+                    s.readStages |= u.stage;
+                    s.visibleStages |= u.stage;
+                }
+            }
+            if (!p.barriers.empty()) {
+                statistics.barriers += (uint32_t)p.barriers.size();
+                statistics.barrierBatches++;
+            }
+        }
+
+        //临时附件每帧复用：每段内存这一帧的第一次写，要等上一帧最后用这段内存的附件读写完
+        for (RGTexture t = 0; t < textures.size(); ++t) {
+            const Texture& texture = textures[t];
+            if (texture.imported || texture.slot == None || texture.aliasOf != None || firstBarrier[t].first == None) continue;
+            const State& last = states[slots[texture.slot].lastTexture];
+            Pass& p = passes[firstBarrier[t].first];
+            p.barriers[firstBarrier[t].second].barrier.srcAccessMask |= last.writeAccess;
+            p.srcStages |= last.writeStages | last.readStages;
+        }
+
+        //导入的图片最后转到外部要的布局（present的信号量负责之后的同步）
+        for (RGTexture t = 0; t < textures.size(); ++t) {
+            if (!textures[t].imported) continue;
+            State& s = states[t];
+            statistics.naiveBarriers++;
+            if (s.layout == textures[t].finalLayout && !s.writeAccess) continue;
+            vk::ImageMemoryBarrier barrier(s.writeAccess, {}, s.layout, textures[t].finalLayout,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, {}, range);
+            finalBarriers.push_back({ t, barrier });
+            vk::PipelineStageFlags src = s.writeStages | s.readStages;
+            finalSrcStages |= src ? src : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+        }
+        if (!finalBarriers.empty()) {
+            statistics.barriers += (uint32_t)finalBarriers.size();
+            statistics.barrierBatches++;
+        }
+    }
+
+    //有颜色附件的pass各建一个render pass：布局转换都由barrier做，附件进出都是 eColorAttachmentOptimal
+    //单个颜色附件、格式相同的render pass互相兼容，场景的pipeline可以直接用在图里的pass上
+    void createRenderPasses()
+    {
+        for (uint32_t index : order) {
+            Pass& p = passes[index];
+            std::vector<vk::AttachmentDescription> attachments;
+            std::vector<vk::AttachmentReference> refs;
+            bool usesImported = false;
+            for (const Access& a : p.accesses) {
+                if (a.usage != RGUsage::ColorAttachment) continue;
+                const Texture& t = textures[a.texture];
+                if (!p.colors.empty() && (t.extent.width != p.extent.width || t.extent.height != p.extent.height))
+                    throw std::runtime_error("render graph: color attachments of pass '" + p.name + "' differ in size");
+                p.extent = t.extent;
+                usesImported |= t.imported;
+                refs.emplace_back((uint32_t)attachments.size(), vk::ImageLayout::eColorAttachmentOptimal);
+                attachments.emplace_back(vk::AttachmentDescriptionFlags{}, t.format, vk::SampleCountFlagBits::e1,
+                    a.loadOp, vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                    vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eColorAttachmentOptimal);
+                p.colors.push_back(a.texture);
+                p.clears.emplace_back(a.clearColor);
+            }
+            if (p.colors.empty()) continue;
+
+            vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics);
+            subpass.colorAttachmentCount = (uint32_t)refs.size();
+            subpass.pColorAttachments = refs.data();
+            vk::RenderPassCreateInfo renderPassInfo({}, attachments, subpass);
+            p.renderPass = (*device)->createRenderPassUnique(renderPassInfo);
+            if (!usesImported) p.framebuffer = createFramebuffer(p);
+        }
+    }
+
+    vk::UniqueFramebuffer createFramebuffer(const Pass& p) const
+    {
+        std::vector<vk::ImageView> views;
+        for (RGTexture t : p.colors) views.push_back(textures[t].view);
+        vk::FramebufferCreateInfo fbInfo({}, *p.renderPass, views, p.extent.width, p.extent.height, 1);
+        return (*device)->createFramebufferUnique(fbInfo);
+    }
+
+    vk::Framebuffer framebuffer(Pass& p)
+    {
+        if (p.framebuffer) return *p.framebuffer;
+        std::vector<VkImageView> key;
+        for (RGTexture t : p.colors) {
+            if (!textures[t].view) throw std::runtime_error("render graph: imported texture '" + textures[t].name + "' was not set");
+            key.push_back(static_cast<VkImageView>(textures[t].view));
+        }
+        auto& cached = p.importedFramebuffers[key];
+        if (!cached) cached = createFramebuffer(p);
+        return *cached;
+    }
+
+    void recordBarriers(vk::CommandBuffer cmd, const std::vector<Barrier>& barriers, vk::PipelineStageFlags src, vk::PipelineStageFlags dst)
+    {
+        scratch.clear();
+        for (const Barrier& b : barriers) {
+            scratch.push_back(b.barrier);
+            scratch.back().image = textures[b.texture].image;
+            if (!scratch.back().image) throw std::runtime_error("render graph: imported texture '" + textures[b.texture].name + "' was not set");
+        }
+        cmd.pipelineBarrier(src, dst, {}, nullptr, nullptr, scratch);
+    }
+
+    //释放compile的结果（声明保留）；先销毁图片再还内存
+    void releaseResources()
+    {
+        for (Pass& p : passes) {
+            p.alive = false;
+            p.barriers.clear();
+            p.srcStages = {};
+            p.dstStages = {};
+            p.importedFramebuffers.clear();
+            p.framebuffer.reset();
+            p.renderPass.reset();
+            p.colors.clear();
+            p.clears.clear();
+            p.extent = vk::Extent2D();
+        }
+        for (Texture& t : textures) {
+            t.ownedView.reset();
+            t.ownedImage.reset();
+            if (!t.imported) {
+                t.image = vk::Image();
+                t.view = vk::ImageView();
+            }
+            t.usage = {};
+            t.firstUse = t.lastUse = t.slot = t.aliasOf = None;
+        }
+        for (Slot& slot : slots) allocator->free(slot.allocation);
+        slots.clear();
+        finalBarriers.clear();
+        finalSrcStages = {};
+        order.clear();
+    }
+
+    const vk::UniqueDevice* device;
+    GpuAllocator* allocator;
+    std::vector<Pass> passes;
+    std::vector<Texture> textures;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> order;
+    std::vector<Barrier> finalBarriers;
+    vk::PipelineStageFlags finalSrcStages;
+    std::vector<vk::ImageMemoryBarrier> scratch;
+    RenderGraphStats statistics;
+};
+
+//compile之后输出一次：执行顺序、剔除、内存别名前后和barrier数
+void PrintRenderGraph(const RenderGraph& graph)
+{
+    const RenderGraphStats& s = graph.stats();
+    std::cout << "[graph] order";
+    for (const std::string& name : graph.orderedPassNames()) std::cout << " | " << name;
+    std::cout << std::endl;
+    std::cout << "[graph] passes " << s.passes << " (culled " << s.culledPasses << ")"
+        << ", transients " << s.transients << " in " << s.allocations << " allocations"
+        << ", memory " << s.bytesWithoutAliasing / 1024 << " KB -> " << s.bytesAllocated / 1024 << " KB"
+        << ", barriers " << s.barriers << " in " << s.barrierBatches << " batches (naive " << s.naiveBarriers << ")" << std::endl;
+}
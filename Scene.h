@@ -0,0 +1,557 @@
+#pragma once
+#include "Tools.h"
+#include "Headless.h"
+#include "Memory.h"
+#include "InstanceRing.h"
+#include "SpriteBatch.h"
+#include "GpuCulling.h"
+#include "BindlessTextures.h"
+#include "PipelineManager.h"
+#include "ParallelRecorder.h"
+#include "GpuProfiler.h"
+#include "SpriteSimulation.h"
+#include "Shapes.h"
+#include "Damage.h"
+#include "RenderGraph.h"
+#include "VertexLayout.h"
+#include <cmath>
+#include <string>
+
+//-----------------场景----------------------
+//几何、场景资源、每帧生成精灵和录制命令：窗口模式、headless模式和benchmark共用
+
+// 【修改】正方形的4个顶点由 test.vert 按 gl_VertexIndex 生成，不再有顶点缓冲，只留索引
+//顶点顺序：左下、右下、右上、左上
+const std::vector<uint16_t> indices = { 0, 1, 2, 2, 3, 0 };
+
+// 【新增】实例数据的顶点输入布局：名字对应 test.vert 的输入，偏移和格式编译期检查
+template<>
+struct VertexLayout<InstanceData> {
+    static constexpr vk::VertexInputRate rate = vk::VertexInputRate::eInstance;
+    static constexpr std::array<VertexAttribute, 5> attributes = {
+        VERTEX_ATTRIBUTE(InstanceData, offset, "inOffset", vk::Format::eR16G16Sfloat),
+        VERTEX_ATTRIBUTE(InstanceData, scale, "inScale", vk::Format::eR16G16Sfloat),
+        VERTEX_ATTRIBUTE(InstanceData, rotation, "inRotation", vk::Format::eR16Unorm),
+        VERTEX_ATTRIBUTE(InstanceData, region, "inRegion", vk::Format::eR16Uint),
+        VERTEX_ATTRIBUTE(InstanceData, color, "inTint", vk::Format::eR8G8B8A8Unorm)
+    };
+};
+
+// 【新增】SDF图形的实例布局（shape.vert）
+template<>
+struct VertexLayout<ShapeInstance> {
+    static constexpr vk::VertexInputRate rate = vk::VertexInputRate::eInstance;
+    static constexpr std::array<VertexAttribute, 7> attributes = {
+        VERTEX_ATTRIBUTE(ShapeInstance, center, "inCenter", vk::Format::eR32G32Sfloat),
+        VERTEX_ATTRIBUTE(ShapeInstance, halfSize, "inHalfSize", vk::Format::eR32G32Sfloat),
+        VERTEX_ATTRIBUTE(ShapeInstance, rotation, "inRotation", vk::Format::eR16Unorm),
+        VERTEX_ATTRIBUTE(ShapeInstance, type, "inType", vk::Format::eR16Uint),
+        VERTEX_ATTRIBUTE(ShapeInstance, params, "inParams", vk::Format::eR16G16Sfloat),
+        VERTEX_ATTRIBUTE(ShapeInstance, aa, "inAA", vk::Format::eR16Sfloat),
+        VERTEX_ATTRIBUTE(ShapeInstance, color, "inColor", vk::Format::eR8G8B8A8Unorm)
+    };
+};
+
+// 【新增】shape.vert 的push constant
+struct ShapePushConstants {
+    float pixelSize[2];     // 一个像素在NDC里的大小
+};
+
+// 【新增】实例位置数组（默认场景；--instances N 时改为N个每帧运动的精灵）
+const std::vector<std::array<float, 2>> instanceOffsets = {
+    {-0.4f, -0.4f}, {0.4f, -0.4f}, {0.0f, 0.4f},
+    {-0.2f, 0.0f}, {0.2f, 0.0f}
+};
+
+// 【新增】场景资源：缓冲、描述符、shader和pipeline，窗口模式和headless模式共用
+struct Scene {
+    GpuBuffer indexBuffer;
+    vk::UniqueDescriptorSetLayout descriptorSetLayout;  // 【修改】set 0：由shader反射生成
+    vk::UniqueDescriptorPool descriptorPool;            // 【新增】set 0 只有贴图区域表一个storage buffer
+    vk::DescriptorSet descriptorSet;                    // 随pool释放
+    vk::UniquePipelineLayout pipelineLayout;
+    std::unique_ptr<BindlessTextures> textures;     // 【新增】set 1：bindless贴图数组
+    std::vector<TextureRef> spriteTextures;         // 【新增】每张精灵图在图集里的位置
+    std::unique_ptr<ShaderLibrary> shaders;         // 【新增】运行时编译 + 热重载（pipelines要用，放在它前面）
+    std::unique_ptr<PipelineManager> pipelines;     // 【新增】pipeline缓存 + 后台编译
+    std::vector<uint64_t> materialPipelines;        // 【新增】Material::pipeline -> PipelineManager的键
+};
+
+// 【新增】材质用到的pipeline变体（下标就是 Material::pipeline）
+enum ScenePipeline : uint8_t {
+    PIPELINE_OPAQUE = 0,
+    PIPELINE_ALPHA,
+    PIPELINE_ADDITIVE,
+    PIPELINE_SHAPES,    // 【新增】SDF图形，不是精灵材质，由图形那一趟单独使用
+    PIPELINE_COUNT
+};
+
+// 【新增】程序生成的精灵图：大小不一的圆，颜色随编号变化，圆外透明
+AtlasImage MakeSpriteImage(uint32_t i)
+{
+    AtlasImage image;
+    image.width = 16 + (i * 7) % 49;
+    image.height = 16 + (i * 13) % 49;
+    image.pixels.resize((size_t)image.width * image.height * 4);
+    float cx = image.width * 0.5f, cy = image.height * 0.5f;
+    float radius = std::min(cx, cy);
+    for (uint32_t y = 0; y < image.height; ++y) {
+        for (uint32_t x = 0; x < image.width; ++x) {
+            float dx = (x + 0.5f - cx) / radius, dy = (y + 0.5f - cy) / radius;
+            float d = std::sqrt(dx * dx + dy * dy);
+            uint8_t* p = &image.pixels[((size_t)y * image.width + x) * 4];
+            p[0] = (uint8_t)(128 + 127 * std::cos(i * 0.7f + d * 3.0f));
+            p[1] = (uint8_t)(128 + 127 * std::cos(i * 1.3f + 2.0f));
+            p[2] = (uint8_t)(128 + 127 * std::cos(i * 2.1f + 4.0f - d * 3.0f));
+            p[3] = d <= 1.0f ? 255 : 0;
+        }
+    }
+    return image;
+}
+
+Scene InitScene(
+    const vk::UniqueDevice& device,
+    const vk::PhysicalDevice& physicalDevice,
+    GpuAllocator& allocator,
+    StagingUploader& uploader,
+    const vk::UniqueRenderPass& renderPass,
+    uint32_t textureCount,
+    const std::string& pipelineCachePath)
+{
+    PROFILE_SCOPE("InitScene");
+    Scene scene;
+
+    // 【修改】静态几何放进 DEVICE_LOCAL 内存，经 staging 和贴图一起批量上传（顶点由shader生成，只剩索引）
+    // 索引缓冲
+    size_t indexSize = sizeof(indices[0]) * indices.size();
+    scene.indexBuffer = createBuffer(device, allocator, indexSize, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst, MemoryUsage::GpuOnly);
+    uploader.upload(scene.indexBuffer, indices.data(), indexSize);
+
+    // 【新增】贴图：小图先装进图集（CPU生成mip），每页作为bindless数组里的一张贴图，和几何一起上传
+    scene.textures = std::make_unique<BindlessTextures>(device, physicalDevice, allocator, uploader);
+    if (textureCount > 0) {
+        TextureAtlasBuilder atlas;
+        for (uint32_t i = 0; i < textureCount; ++i) atlas.add(MakeSpriteImage(i));
+        atlas.build();
+        scene.spriteTextures = scene.textures->addAtlas(atlas, textureCount);
+        std::cout << "[atlas] images " << textureCount << ", pages " << atlas.atlasPages().size()
+            << ", occupancy " << atlas.averageOccupancy() * 100.0f << "%" << std::endl;
+    }
+    uploader.flush();
+    // 实例数据不在这里：每帧写进 InstanceRing
+
+    // 【修改】shader运行时编译，顶点输入、描述符布局和push constant都从反射结果生成：
+    //        C++这边只按名字列出字段在哪个缓冲、哪个偏移，改shader不用再手改location和格式
+    scene.shaders = std::make_unique<ShaderLibrary>();
+    auto vert = scene.shaders->get("Shader/test.vert");
+    auto frag = scene.shaders->get("Shader/test.frag");
+    auto shapeVert = scene.shaders->get("Shader/shape.vert");
+    auto shapeFrag = scene.shaders->get("Shader/shape.frag");
+
+    // 【修改】只有一路实例数据（binding 0），布局见上面的 VertexLayout<InstanceData>
+    std::vector<VertexStream> streams = { MakeVertexStream<InstanceData>(0) };
+    std::vector<VertexField> fields;
+    AppendVertexFields<InstanceData>(fields, 0);
+
+    //set 1 的bindless布局由 BindlessTextures 自己建，这里只确认shader和它一致
+    ExpectBinding(*frag, 1, 0, DescriptorKind::CombinedImageSampler, true);
+    scene.descriptorSetLayout = InitDescriptorSetLayout(device, MakeSetLayoutBindings({ vert.get(), frag.get() }, 0));
+
+    // 【新增】set 0 binding 0：贴图区域表（实例里只存区域下标，UV范围和贴图下标在这里查）
+    ExpectBinding(*vert, 0, 0, DescriptorKind::StorageBuffer, false);
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 1);
+    scene.descriptorPool = device->createDescriptorPoolUnique({ {}, 1, 1, &poolSize });
+    vk::DescriptorSetAllocateInfo allocInfo(*scene.descriptorPool, 1, &*scene.descriptorSetLayout);
+    scene.descriptorSet = device->allocateDescriptorSets(allocInfo)[0];
+    vk::DescriptorBufferInfo regionInfo(scene.textures->regionBuffer(), 0, scene.textures->regionBufferSize());
+    vk::WriteDescriptorSet regionWrite(scene.descriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &regionInfo);
+    device->updateDescriptorSets(regionWrite, nullptr);
+
+    // 【修改】Pipeline 交给 PipelineManager：不透明的基础pipeline阻塞等它编好，
+    //        其余混合模式在后台编译，编好之前用不透明的顶替
+    //精灵和SDF图形共用一个pipeline layout（图形不用描述符，push constant只有shape.vert有）
+    scene.pipelineLayout = InitPipelineLayout(device, scene.descriptorSetLayout, scene.textures->layout(),
+        MakePushConstantRanges({ vert.get(), frag.get(), shapeVert.get(), shapeFrag.get() }));
+    scene.pipelines = std::make_unique<PipelineManager>(device, physicalDevice, renderPass, *scene.pipelineLayout, *scene.shaders, pipelineCachePath);
+
+    PipelineDesc desc;
+    desc.vertShader = "Shader/test.vert";
+    desc.fragShader = "Shader/test.frag";
+    MakeVertexInput(vert->reflection, streams, fields, desc.bindings, desc.attributes);
+    scene.materialPipelines.resize(PIPELINE_COUNT);
+    scene.materialPipelines[PIPELINE_OPAQUE] = scene.pipelines->request(desc);
+    desc.blend = BlendMode::Alpha;
+    scene.materialPipelines[PIPELINE_ALPHA] = scene.pipelines->request(desc, scene.materialPipelines[PIPELINE_OPAQUE]);
+    desc.blend = BlendMode::Additive;
+    scene.materialPipelines[PIPELINE_ADDITIVE] = scene.pipelines->request(desc, scene.materialPipelines[PIPELINE_OPAQUE]);
+
+    // 【新增】SDF图形：顶点输入不同，没有可以顶替的pipeline，后台编好之前图形先不画
+    PipelineDesc shapeDesc;
+    shapeDesc.vertShader = "Shader/shape.vert";
+    shapeDesc.fragShader = "Shader/shape.frag";
+    shapeDesc.blend = BlendMode::Alpha;
+    std::vector<VertexField> shapeFields;
+    AppendVertexFields<ShapeInstance>(shapeFields, 0);
+    MakeVertexInput(shapeVert->reflection, { MakeVertexStream<ShapeInstance>(0) }, shapeFields, shapeDesc.bindings, shapeDesc.attributes);
+    scene.materialPipelines[PIPELINE_SHAPES] = scene.pipelines->request(shapeDesc);
+
+    auto start = std::chrono::steady_clock::now();
+    scene.pipelines->wait(scene.materialPipelines[PIPELINE_OPAQUE]);
+    std::cout << "[pipeline] base pipeline ready after "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+        << (scene.pipelines->loadedFromDisk() ? " (disk cache)" : "") << std::endl;
+    return scene;
+}
+
+// 【修改】每帧通过批处理提交精灵，排序合批后写进环形缓冲
+//textures不为空时精灵轮流使用其中的贴图（全部在同一批里）
+void BuildSprites(SpriteBatch& batch, uint32_t count, float time, float worldSize, const std::vector<TextureRef>& textures)
+{
+    if (count <= instanceOffsets.size()) {
+        for (uint32_t i = 0; i < count; ++i)
+            batch.drawQuad(instanceOffsets[i][0], instanceOffsets[i][1], 1.0f, 1.0f, PackColor(255, 255, 255));
+        return;
+    }
+    //铺成网格，每个精灵绕自己的格点转圈；分4层交错提交，排序后仍然合成一批
+    uint32_t side = (uint32_t)std::ceil(std::sqrt((double)count));
+    float cell = 2.0f * worldSize / side;
+    float scale = cell / 0.2f * 0.5f;  // 单位正方形边长0.2，缩到半个格子
+    for (uint32_t i = 0; i < count; ++i) {
+        float phase = time * 2.0f + i * 0.37f;
+        SpriteTransform t;
+        t.x = -worldSize + cell * (i % side + 0.5f) + std::cos(phase) * cell * 0.25f;
+        t.y = -worldSize + cell * (i / side + 0.5f) + std::sin(phase) * cell * 0.25f;
+        t.scaleX = t.scaleY = scale;
+        t.rotation = phase;
+        uint32_t color = PackColor((uint8_t)(i * 37), (uint8_t)(i * 91), (uint8_t)(i * 53));
+        TextureRef texture = textures.empty() ? TextureRef{} : textures[i % textures.size()];
+        //最上面一层用叠加混合（后台编译的变体，编好之前先按不透明画）
+        Material material;
+        material.pipeline = i % 4 == 3 ? PIPELINE_ADDITIVE : PIPELINE_OPAQUE;
+        batch.drawSprite(t, color, texture, material, (uint8_t)(i % 4));
+    }
+}
+
+// 【新增】--simulate：精灵由 SpriteSimulation 模拟，SIMD内核直接写进本帧的实例段，不经过排序合批
+//grid不为空时同一趟里同步空间索引，只上传屏幕里的精灵（--world大于1时大部分在屏幕外）
+//每帧都在动的精灵同步索引要花不少时间（见 Simple2DSimBenchmark 的 simulate+visible），所以要 --grid 才打开
+void BuildSimulatedSprites(SpriteBatch& batch, SpriteSimulation& simulation, InstanceRing<InstanceData>& instances, uint32_t frame,
+    float dt, JobSystem* jobs, SpatialGrid* grid = nullptr)
+{
+    batch.begin();
+    batch.end(nullptr);     // 没有需要排序的精灵
+    InstanceData* dst = instances.begin(frame, simulation.size());
+    uint32_t count = simulation.size();
+    if (grid) count = simulation.updateVisible(dt, dst, *grid, Bounds2D{ -1.0f, -1.0f, 1.0f, 1.0f }, jobs);
+    else simulation.update(dt, dst, jobs);
+    batch.appendRun(Material{}, count);
+}
+
+// 【新增】--shapes：一块用SDF图形画的图表面板（柱状图 + 折线 + 圆环仪表），全部一次draw
+//横向的位置和宽度都乘aspect，面板始终占满屏幕宽度；圆和圆环不会随窗口比例变形
+void BuildShapes(ShapeBatch& shapes, float time)
+{
+    const float aspect = shapes.aspect();
+    //面板在屏幕下方（Vulkan的NDC里y向下）
+    shapes.drawRoundedRect(0.0f, 0.68f, 0.92f * aspect, 0.28f, 0.04f, { PackColor(20, 24, 32, 200) });
+    shapes.drawRoundedRect(0.0f, 0.68f, 0.92f * aspect, 0.28f, 0.04f, { PackColor(90, 110, 140), 0.006f });
+
+    const uint32_t points = 12;
+    const float left = -0.82f * aspect, right = 0.36f * aspect, baseline = 0.9f;
+    float step = (right - left) / (points - 1);
+    float prevX = 0.0f, prevY = 0.0f;
+    for (uint32_t i = 0; i < points; ++i) {
+        float x = left + step * i;
+        //柱子：从基线往上长
+        float height = 0.04f + 0.14f * (0.5f + 0.5f * std::sin(time * 1.3f + i * 0.8f));
+        shapes.drawRoundedRect(x, baseline - height * 0.5f, step * 0.3f, height * 0.5f, 0.008f,
+            { PackColor(70, 150, 220, 220) });
+        //折线和数据点
+        float y = 0.56f + 0.07f * std::sin(time * 0.9f + i * 0.55f);
+        if (i > 0) shapes.drawLine(prevX, prevY, x, y, 0.006f, { PackColor(250, 200, 80) });
+        prevX = x;
+        prevY = y;
+    }
+    for (uint32_t i = 0; i < points; ++i) {
+        float x = left + step * i;
+        float y = 0.56f + 0.07f * std::sin(time * 0.9f + i * 0.55f);
+        shapes.drawCircle(x, y, 0.014f, { PackColor(20, 24, 32) });
+        shapes.drawCircle(x, y, 0.014f, { PackColor(250, 200, 80), 0.005f });
+    }
+    shapes.drawLine(left - step * 0.5f, baseline, right + step * 0.5f, baseline, 0.004f, { PackColor(160, 170, 190) });
+
+    //圆环仪表：底环 + 按比例转动的指针
+    float value = 0.5f + 0.5f * std::sin(time * 0.7f);
+    float gaugeX = 0.64f * aspect;
+    shapes.drawRing(gaugeX, 0.68f, 0.15f, 0.03f, PackColor(60, 70, 90));
+    shapes.drawRing(gaugeX, 0.68f, 0.15f * value, 0.012f, PackColor(120, 220, 140));
+    float angle = value * 6.28318531f;
+    shapes.drawLine(gaugeX, 0.68f, gaugeX + 0.12f * std::cos(angle), 0.68f + 0.12f * std::sin(angle), 0.01f, { PackColor(240, 240, 240) });
+    shapes.drawCircle(gaugeX, 0.68f, 0.018f, { PackColor(240, 240, 240) });
+}
+
+// 【新增】每帧录制耗时
+struct RecordStats {
+    double ms = 0.0;
+    uint32_t secondaries = 0;   // 0表示单线程录制进primary
+};
+
+//每次帧统计输出时顺带输出合批、剔除和录制情况
+void PrintBatchStats(const SpriteBatchStats& s, const CullStats* cull, const RecordStats& record)
+{
+    std::cout << "[batch] sprites " << s.sprites << ", draw calls " << s.drawCalls
+        << ", pipeline changes " << s.pipelineChanges << ", texture changes " << s.textureChanges
+        << ", sort " << s.sortMs << " ms";
+    if (cull) std::cout << ", gpu cull visible " << cull->visible << " / culled " << cull->culled;
+    std::cout << ", record " << record.ms << " ms";
+    if (record.secondaries) std::cout << " (" << record.secondaries << " secondaries)";
+    std::cout << std::endl;
+}
+
+// 【新增】一次draw画本帧的全部SDF图形（viewport/scissor由调用者设置）
+void RecordShapes(
+    vk::CommandBuffer cmd,
+    const vk::Extent2D& extent,
+    const Scene& scene,
+    const InstanceRing<ShapeInstance>& shapes,
+    vk::Pipeline pipeline,
+    GpuProfiler* gpuProfiler,
+    uint32_t frame)
+{
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    ShapePushConstants pc = { { 2.0f / extent.width, 2.0f / extent.height } };
+    cmd.pushConstants<ShapePushConstants>(*scene.pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, pc);
+    cmd.bindVertexBuffers(0, { shapes.buffer() }, { 0 });
+    cmd.bindIndexBuffer(*scene.indexBuffer, 0, vk::IndexType::eUint16);
+    uint32_t zone = gpuProfiler ? gpuProfiler->begin(cmd, frame, "shapes") : GpuProfiler::NoZone;
+    cmd.drawIndexed(static_cast<uint32_t>(indices.size()), shapes.count(), 0, 0, shapes.firstInstance());
+    if (gpuProfiler) gpuProfiler->end(cmd, frame, zone);
+}
+
+// 【新增】在一个command buffer里画合批结果的[begin, end)段：单线程时录进primary，多线程时每段一个secondary
+//secondary不继承任何状态，所以每段都要重新设置viewport/scissor和绑定
+void RecordDraws(
+    vk::CommandBuffer cmd,
+    const vk::Extent2D& extent,
+    const Scene& scene,
+    const InstanceRing<InstanceData>& instances,
+    const SpriteBatch& batch,
+    const InstanceRing<ShapeInstance>* shapes,
+    const GpuCuller* culler,
+    uint32_t frame,
+    const std::array<vk::Pipeline, PIPELINE_COUNT>& pipelines,
+    GpuProfiler* gpuProfiler,
+    uint32_t begin,
+    uint32_t end)
+{
+    // 【新增】viewport/scissor 是动态状态
+    cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f));
+    cmd.setScissor(0, vk::Rect2D({ 0, 0 }, extent));
+    // 【修改】set 0 是贴图区域表，set 1 是bindless贴图数组：整帧只绑定这一次
+    std::array<vk::DescriptorSet, 2> sets = { scene.descriptorSet, scene.textures->set() };
+    cmd.bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics,
+        *scene.pipelineLayout,
+        0, (uint32_t)sets.size(), sets.data(),
+        0, nullptr
+    );
+    // 【新增】SDF图形画在所有精灵之后：由录制最后一段的那个command buffer来画
+    bool drawShapes = shapes && shapes->count() > 0 && end == batch.draws().size();
+    if (begin == end && !drawShapes) return;
+    // 绘制命令改为使用索引绘制
+    // 【修改】实例来自环形缓冲：buffer绑定不变，用firstInstance指向本帧的那一段
+    //        开启GPU剔除时改为绑定剔除后的输出缓冲，实例数由GPU写进间接命令
+    if (culler && !culler->active(frame)) culler = nullptr;    // 这一帧没有剔除
+    vk::Buffer instanceBuffer = culler ? culler->output(frame) : instances.buffer();
+    cmd.bindVertexBuffers(0, { instanceBuffer }, { 0 });
+    cmd.bindIndexBuffer(*scene.indexBuffer, 0, vk::IndexType::eUint16);
+    // 【修改】按合批结果绘制：只在pipeline变化时重新绑定（贴图下标在实例数据里，不需要重新绑定）
+    vk::Pipeline boundPipeline;
+    // 【修改】每段绘制（并行录制时每个secondary一段）前后写一对GPU时间戳，不再每个draw一对：小批次很多时不会超出每帧的段数
+    uint32_t zone = gpuProfiler && begin < end ? gpuProfiler->begin(cmd, frame, "draws") : GpuProfiler::NoZone;
+    for (uint32_t i = begin; i < end; ++i) {
+        const SpriteDrawCmd& draw = batch.draws()[i];
+        vk::Pipeline pipeline = pipelines[draw.material.pipeline];
+        if (!pipeline) continue;
+        if (pipeline != boundPipeline) {
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+            boundPipeline = pipeline;
+        }
+        if (culler) culler->drawIndirect(cmd, frame, i);
+        else cmd.drawIndexed(static_cast<uint32_t>(indices.size()), draw.instanceCount, 0, 0, instances.firstInstance() + draw.firstInstance);
+    }
+    if (gpuProfiler) gpuProfiler->end(cmd, frame, zone);
+
+    if (drawShapes && pipelines[PIPELINE_SHAPES]) RecordShapes(cmd, extent, scene, *shapes, pipelines[PIPELINE_SHAPES], gpuProfiler, frame);
+}
+
+//录制一帧的绘制命令（每帧重新录制，录制的是当前这套每帧资源的command buffer）
+//recorder不为空时，render pass里的绘制分段并行录进secondary
+//shapes不为空时，在精灵之后用一次draw画本帧的SDF图形
+//gpuProfiler不为空时，在剔除、render pass和每个draw批次前后写时间戳
+//target/readback不为空时（headless模式），在render pass结束后把画面拷进读回buffer
+RecordStats RecordCommandBuffer(
+    vk::CommandBuffer cmd,
+    const vk::UniqueRenderPass& renderPass,
+    const vk::UniqueFramebuffer& framebuffer,
+    const vk::Extent2D& extent,
+    const Scene& scene,
+    const InstanceRing<InstanceData>& instances,
+    const SpriteBatch& batch,
+    const InstanceRing<ShapeInstance>* shapes,
+    GpuCuller* culler,
+    ParallelRecorder* recorder,
+    GpuProfiler* gpuProfiler,
+    uint32_t frame,
+    const OffscreenTarget* target = nullptr,
+    ReadbackSlot* readback = nullptr,
+    uint64_t frameIndex = 0)
+{
+    PROFILE_SCOPE("RecordCommandBuffer");
+    auto start = std::chrono::steady_clock::now();
+    RecordStats stats;
+    cmd.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    // 【新增】取回这套资源上一轮的GPU时间戳，reset query（必须在render pass外）
+    if (gpuProfiler) gpuProfiler->beginFrame(cmd, frame);
+    // 【新增】GPU剔除：render pass之前先跑compute，把可见实例压缩到输出缓冲并生成间接命令
+    if (culler) {
+        uint32_t zone = gpuProfiler ? gpuProfiler->begin(cmd, frame, "cull") : GpuProfiler::NoZone;
+        culler->record(cmd, frame, instances.buffer(), sizeof(InstanceData) * (vk::DeviceSize)instances.firstInstance(), batch.draws(),
+            { -1.0f, -1.0f, 1.0f, 1.0f });
+        if (gpuProfiler) gpuProfiler->end(cmd, frame, zone);
+    }
+    // 每个材质的pipeline每帧只查一次（变体还在后台编译时得到后备pipeline；get()要加锁，不放进每个draw里）
+    std::array<vk::Pipeline, PIPELINE_COUNT> pipelines;
+    for (uint32_t i = 0; i < PIPELINE_COUNT; ++i) pipelines[i] = scene.pipelines->get(scene.materialPipelines[i]);
+
+    uint32_t drawCount = (uint32_t)batch.draws().size();
+    vk::ClearValue clearColor(std::array<float, 4>{0.1f, 0.1f, 0.1f, 1.0f});
+    vk::RenderPassBeginInfo rpBegin(*renderPass, *framebuffer, { {0,0}, extent }, clearColor);
+    uint32_t passZone = gpuProfiler ? gpuProfiler->begin(cmd, frame, "render pass") : GpuProfiler::NoZone;
+    if (recorder && drawCount > 0) {
+        cmd.beginRenderPass(rpBegin, vk::SubpassContents::eSecondaryCommandBuffers);
+        vk::CommandBufferInheritanceInfo inheritance(*renderPass, 0, *framebuffer);
+        const auto& secondaries = recorder->record(frame, drawCount, inheritance, [&](vk::CommandBuffer secondary, uint32_t begin, uint32_t end) {
+            PROFILE_SCOPE("record chunk");
+            RecordDraws(secondary, extent, scene, instances, batch, shapes, culler, frame, pipelines, gpuProfiler, begin, end);
+        });
+        cmd.executeCommands(secondaries);
+        stats.secondaries = (uint32_t)secondaries.size();
+    }
+    else {
+        cmd.beginRenderPass(rpBegin, vk::SubpassContents::eInline);
+        RecordDraws(cmd, extent, scene, instances, batch, shapes, culler, frame, pipelines, gpuProfiler, 0, drawCount);
+    }
+    cmd.endRenderPass();
+    if (gpuProfiler) gpuProfiler->end(cmd, frame, passZone);
+    if (target && readback) RecordReadback(cmd, *target, *readback, extent, frameIndex);
+    cmd.end();
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// 【新增】在渲染图里声明场景pass：精灵 + SDF图形画进target（render pass、viewport/scissor由图设置）
+//多线程录制不走渲染图（secondary要在开始render pass时就知道framebuffer）
+void AddScenePass(
+    RenderGraph& graph,
+    RGTexture target,
+    const Scene& scene,
+    const InstanceRing<InstanceData>& instances,
+    const SpriteBatch& batch,
+    const InstanceRing<ShapeInstance>* shapes,
+    const GpuCuller* culler,
+    GpuProfiler* gpuProfiler)
+{
+    graph.addPass("scene", [&scene, &instances, &batch, shapes, culler, gpuProfiler](const RGContext& ctx) {
+        std::array<vk::Pipeline, PIPELINE_COUNT> pipelines;
+        for (uint32_t i = 0; i < PIPELINE_COUNT; ++i) pipelines[i] = scene.pipelines->get(scene.materialPipelines[i]);
+        RecordDraws(ctx.cmd, ctx.extent, scene, instances, batch, shapes, culler, ctx.frame, pipelines, gpuProfiler,
+            0, (uint32_t)batch.draws().size());
+    }).write(target, vk::AttachmentLoadOp::eClear, { 0.1f, 0.1f, 0.1f, 1.0f });
+}
+
+// 【新增】按渲染图录制一帧：GPU剔除（buffer由剔除模块自己同步）之后执行图里的全部pass
+RecordStats RecordGraphFrame(
+    vk::CommandBuffer cmd,
+    RenderGraph& graph,
+    const InstanceRing<InstanceData>& instances,
+    const SpriteBatch& batch,
+    GpuCuller* culler,
+    GpuProfiler* gpuProfiler,
+    uint32_t frame)
+{
+    PROFILE_SCOPE("RecordGraphFrame");
+    auto start = std::chrono::steady_clock::now();
+    RecordStats stats;
+    cmd.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    if (gpuProfiler) gpuProfiler->beginFrame(cmd, frame);
+    if (culler) {
+        uint32_t zone = gpuProfiler ? gpuProfiler->begin(cmd, frame, "cull") : GpuProfiler::NoZone;
+        culler->record(cmd, frame, instances.buffer(), sizeof(InstanceData) * (vk::DeviceSize)instances.firstInstance(), batch.draws(),
+            { -1.0f, -1.0f, 1.0f, 1.0f });
+        if (gpuProfiler) gpuProfiler->end(cmd, frame, zone);
+    }
+    graph.execute(cmd, gpuProfiler, frame);
+    cmd.end();
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// 【新增】脏矩形模式的一帧（--dashboard）：静态层只按脏矩形拷进swapchain图片，
+//        再用eLoad的render pass、每个脏矩形设一次scissor，只在这些区域里重画动态的SDF图形
+//静态层一直是 eTransferSrcOptimal；region.full 时图片原来的内容直接丢掉
+//提交时acquire的信号量要在 eTransfer 阶段等待
+//返回false表示图形的pipeline还在后台编译、这些区域里只有静态层，调用者要把它们重新标脏
+bool RecordDamagedFrame(
+    vk::CommandBuffer cmd,
+    const vk::UniqueRenderPass& loadPass,
+    const vk::UniqueFramebuffer& framebuffer,
+    vk::Image image,
+    const vk::Extent2D& extent,
+    const Scene& scene,
+    vk::Image staticLayer,
+    const DamageRegion& region,
+    const InstanceRing<ShapeInstance>& shapes,
+    uint32_t frame)
+{
+    PROFILE_SCOPE("RecordDamagedFrame");
+    cmd.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    //静态层的绘制（更早的提交）-> 拷贝读取；上次present的图片 -> 拷贝目标
+    vk::MemoryBarrier layerReady(vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead);
+    vk::ImageMemoryBarrier toTransfer({}, vk::AccessFlagBits::eTransferWrite,
+        region.full ? vk::ImageLayout::eUndefined : vk::ImageLayout::ePresentSrcKHR, vk::ImageLayout::eTransferDstOptimal,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eTransfer, {}, layerReady, nullptr, toTransfer);
+
+    std::vector<vk::ImageCopy> copies;
+    vk::ImageSubresourceLayers layers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    for (const DamageRect& r : region.rects) {
+        vk::Offset3D offset(r.x0, r.y0, 0);
+        copies.emplace_back(layers, offset, layers, offset, vk::Extent3D((uint32_t)(r.x1 - r.x0), (uint32_t)(r.y1 - r.y0), 1));
+    }
+    if (!copies.empty())
+        cmd.copyImage(staticLayer, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, copies);
+
+    //拷贝 -> 颜色附件（loadPass的initialLayout是 eColorAttachmentOptimal）
+    vk::ImageMemoryBarrier toColor(vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eColorAttachmentOptimal,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, nullptr, nullptr, toColor);
+
+    cmd.beginRenderPass(vk::RenderPassBeginInfo(*loadPass, *framebuffer, { {0,0}, extent }), vk::SubpassContents::eInline);
+    vk::Pipeline pipeline = scene.pipelines->get(scene.materialPipelines[PIPELINE_SHAPES]);
+    bool drawn = pipeline || shapes.count() == 0;
+    if (pipeline && shapes.count() > 0) {
+        cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f));
+        for (const DamageRect& r : region.rects) {
+            cmd.setScissor(0, vk::Rect2D({ r.x0, r.y0 }, { (uint32_t)(r.x1 - r.x0), (uint32_t)(r.y1 - r.y0) }));
+            RecordShapes(cmd, extent, scene, shapes, pipeline, nullptr, frame);
+        }
+    }
+    cmd.endRenderPass();
+    cmd.end();
+    return drawn;
+}
@@ -0,0 +1,32 @@
+#version 450
+// 泛光的亮部提取和分离高斯模糊共用：
+// direction为0时只采样一次，保留超过阈值的那部分亮度；否则沿direction做9阶高斯（利用线性过滤合并成5次采样）
+layout(location = 0) in vec2 fragUV;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+layout(push_constant) uniform Params {
+    vec2 direction;     // 相邻采样点的UV步长
+    float threshold;    // 亮度阈值（只在亮部提取时用）
+    float pad;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+    if (pc.direction == vec2(0.0)) {
+        vec3 color = texture(source, fragUV).rgb;
+        float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+        outColor = vec4(color * (max(luminance - pc.threshold, 0.0) / max(luminance, 1e-4)), 1.0);
+        return;
+    }
+    vec3 sum = texture(source, fragUV).rgb * weights[0];
+    for (int i = 1; i < 3; ++i) {
+        sum += texture(source, fragUV + pc.direction * offsets[i]).rgb * weights[i];
+        sum += texture(source, fragUV - pc.direction * offsets[i]).rgb * weights[i];
+    }
+    outColor = vec4(sum, 1.0);
+}
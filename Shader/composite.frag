@@ -0,0 +1,19 @@
+#version 450
+// 合成：场景颜色 + 泛光 * 强度
+layout(location = 0) in vec2 fragUV;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+layout(set = 0, binding = 1) uniform sampler2D bloom;
+
+layout(push_constant) uniform Params {
+    vec2 direction;     // 不用，和 blur.frag 共用一个push constant布局
+    float strength;
+    float pad;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 color = texture(sceneColor, fragUV).rgb + texture(bloom, fragUV).rgb * pc.strength;
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 450
+// 全屏pass：3个顶点由 gl_VertexIndex 生成一个盖住整个屏幕的三角形（超出的部分被裁掉），没有顶点输入
+// UV原点在左上角，和Vulkan的NDC一样y向下
+layout(location = 0) out vec2 fragUV;
+
+void main() {
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    fragUV = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
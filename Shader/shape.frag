@@ -0,0 +1,37 @@
+#version 450
+// SDF图形：按类型算到边界的有向距离（里面为负），描边取边界内侧一圈，再按屏幕导数做解析抗锯齿
+layout(location = 0) in vec2 fragLocal;
+layout(location = 1) flat in vec2 fragHalfSize;
+layout(location = 2) flat in uint fragType;
+layout(location = 3) flat in vec2 fragParams;   // 圆角半径、描边宽度
+layout(location = 4) flat in float fragAA;
+layout(location = 5) flat in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+// 和 C++ 里的 ShapeType 一致
+const uint SHAPE_CIRCLE = 0u;
+const uint SHAPE_ROUNDED_RECT = 1u;
+const uint SHAPE_CAPSULE = 2u;
+
+float sdRoundedBox(vec2 p, vec2 halfSize, float radius) {
+    radius = min(radius, min(halfSize.x, halfSize.y));
+    vec2 q = abs(p) - halfSize + radius;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+void main() {
+    float d;
+    if (fragType == SHAPE_CIRCLE) d = length(fragLocal) - fragHalfSize.x;
+    else if (fragType == SHAPE_CAPSULE) d = sdRoundedBox(fragLocal, fragHalfSize, fragHalfSize.y);
+    else d = sdRoundedBox(fragLocal, fragHalfSize, fragParams.x);
+
+    float stroke = fragParams.y;
+    if (stroke > 0.0) d = abs(d + stroke * 0.5) - stroke * 0.5;
+
+    // 距离的屏幕梯度 = 一个像素对应多少距离，覆盖率在 fragAA 个像素内从1降到0
+    float width = max(length(vec2(dFdx(d), dFdy(d))) * fragAA, 1e-6);
+    float coverage = clamp(0.5 - d / width, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
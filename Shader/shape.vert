@@ -0,0 +1,42 @@
+#version 450
+// SDF图形：和精灵共用索引缓冲（0,1,2,2,3,0），正方形的4个角由 gl_VertexIndex 生成
+// 实例数据和 C++ 里的 ShapeInstance 一致
+layout(location = 0) in vec2 inCenter;
+layout(location = 1) in vec2 inHalfSize;    // 图形本身的半宽高（旋转之前）
+layout(location = 2) in float inRotation;   // unorm16，[0,1] 对应 [0, 2π]
+layout(location = 3) in uint inType;
+layout(location = 4) in vec2 inParams;      // 圆角半径、描边宽度（half）
+layout(location = 5) in float inAA;         // 抗锯齿过渡带宽度（像素，half）
+layout(location = 6) in vec4 inColor;       // RGBA8 unorm
+
+layout(push_constant) uniform Params {
+    vec2 pixelSize;     // 一个像素在NDC里的大小（2/宽, 2/高）
+} pc;
+
+// 实例的坐标按宽高比修正过（x是[-宽/高, 宽/高]，两个方向一个像素都是 pixelSize.y），输出前x再乘回 高/宽
+
+layout(location = 0) out vec2 fragLocal;    // 本地坐标（以图形中心为原点，旋转之前）
+layout(location = 1) flat out vec2 fragHalfSize;
+layout(location = 2) flat out uint fragType;
+layout(location = 3) flat out vec2 fragParams;
+layout(location = 4) flat out float fragAA;
+layout(location = 5) flat out vec4 fragColor;
+
+const vec2 corners[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    // 正方形向外多扩一点，给边缘的抗锯齿过渡带留位置
+    float pad = (inAA + 1.0) * pc.pixelSize.y;
+    vec2 local = corners[gl_VertexIndex & 3] * (inHalfSize + pad);
+    float angle = inRotation * 6.28318531;
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 position = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + inCenter;
+    gl_Position = vec4(position * vec2(pc.pixelSize.x / pc.pixelSize.y, 1.0), 0.0, 1.0);
+    fragLocal = local;
+    fragHalfSize = inHalfSize;
+    fragType = inType;
+    fragParams = inParams;
+    fragAA = inAA;
+    fragColor = inColor;
+}
@@ -1,20 +1,25 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 layout(location = 0) in vec3 fragColor;
-layout(location = 1) in vec2 fragPos;  // 【新增】接收顶点位置
+layout(location = 1) in vec2 fragPos;  // 【修改】接收正方形上的归一化坐标（[-1,1]）
+layout(location = 2) in vec2 fragUV;
+layout(location = 3) flat in uint fragTexture;
+
+// 【新增】bindless贴图数组：同一次绘制里每个实例可以用不同的贴图
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    // 计算到正方形边界的距离（假设正方形边长为1.0）
-    float edgeWidth = 0.05;  // 边缘宽度（可调）
-    float distanceToEdge = min(
-        min(abs(fragPos.x - 0.5), abs(fragPos.x + 0.5)),  // X方向
-        min(abs(fragPos.y - 0.5), abs(fragPos.y + 0.5))   // Y方向
-    );
+    vec4 texel = texture(textures[nonuniformEXT(fragTexture)], fragUV);
+    if (texel.a < 0.5) discard;  // 精灵图的透明部分
+    // 【修改】计算到正方形边界的距离：fragPos 是归一化坐标，边界在±1上，不管正方形实际画多大
+    float edgeWidth = 0.1;  // 边缘宽度（可调，边长的5%）
+    float distanceToEdge = 1.0 - max(abs(fragPos.x), abs(fragPos.y));
     
     // 如果接近边缘，则混合黑色
     float edgeFactor = smoothstep(0.0, edgeWidth, distanceToEdge);
     vec3 finalColor = mix(vec3(0.0), fragColor, edgeFactor);  // 混合黑色和原色
     
-    outColor = vec4(finalColor, 1.0);
+    outColor = vec4(finalColor * texel.rgb, 1.0);
 }
\ No newline at end of file
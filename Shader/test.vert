@@ -1,13 +1,42 @@
 #version 450
-layout(location = 0) in vec2 inPos;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inOffset;
+// 【修改】没有顶点缓冲：单位正方形的4个角由 gl_VertexIndex 生成（索引缓冲 0,1,2,2,3,0）
+//        实例数据压缩到16字节，贴图和UV范围从区域表里查
+layout(location = 0) in vec2 inOffset;    // 实例位置（half）
+layout(location = 1) in vec2 inScale;     // 实例缩放（half）
+layout(location = 2) in float inRotation; // 实例旋转（unorm16，[0,1] 对应 [0, 2π]）
+layout(location = 3) in uint inRegion;    // 贴图区域下标
+layout(location = 4) in vec4 inTint;      // 实例颜色（RGBA8 unorm）
+
+// 和 C++ 里的 TextureRegion 一致（std430下32字节）
+struct Region {
+    vec4 uvRect;        // 图集里的UV范围
+    uint texture;       // bindless贴图下标
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Regions { Region regions[]; };
 
 layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec2 fragPos;  // 【新增】传递顶点位置到片段着色器
+layout(location = 1) out vec2 fragPos;  // 【修改】正方形上的归一化坐标，片段着色器画边框用
+layout(location = 2) out vec2 fragUV;
+layout(location = 3) flat out uint fragTexture;
+
+const vec2 corners[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+const float quadHalf = 0.1;                  // 单位正方形的半边长（和C++里剔除用的一致）
+const vec3 quadColor = vec3(1.0, 0.0, 0.0);  // 原来4个顶点的颜色都是红色
 
 void main() {
-    gl_Position = vec4(inPos + inOffset, 0.0, 1.0);
-    fragColor = inColor;
-    fragPos = inPos;  // 【新增】传递原始顶点坐标（未偏移）
-}
\ No newline at end of file
+    vec2 corner = corners[gl_VertexIndex & 3];
+    vec2 pos = corner * quadHalf;
+    float angle = inRotation * 6.28318531;
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 local = pos * inScale;
+    gl_Position = vec4(vec2(c * local.x - s * local.y, s * local.x + c * local.y) + inOffset, 0.0, 1.0);
+    fragColor = quadColor * inTint.rgb;
+    fragPos = corner;  // 【修改】传递单位正方形上的坐标（[-1,1]，和quadHalf、缩放无关）
+    Region region = regions[inRegion];
+    fragUV = mix(region.uvRect.xy, region.uvRect.zw, corner * 0.5 + 0.5);
+    fragTexture = region.texture;
+}
@@ -0,0 +1,375 @@
+#pragma once
+#include "Tools.h"
+#include "SpirvReflect.h"
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+#include <sstream>
+#ifdef SIMPLE2D_RUNTIME_SHADERS
+#include <shaderc/shaderc.hpp>
+#endif
+
+//-----------------Shader库----------------------
+//定义 SIMPLE2D_RUNTIME_SHADERS 时（CMake找到shaderc时自动定义，VS工程总是定义）运行时用shaderc编译GLSL源码，
+//结果按 源码+宏定义+阶段 的哈希存进磁盘缓存，源码没改过的第二次启动直接读缓存，不再编译；
+//没有shaderc时读离线编译好的 <源文件>.spv（着色器编译.bat 的输出）
+//poll() 检查源文件（或.spv）的修改时间，变了就重新编译，用于热重载
+//每个shader都附带反射结果，顶点输入、描述符布局、push constant范围由它生成
+
+//一个编译好的shader（不可变；热重载时换成新的对象，旧的仍被持有者安全使用）
+struct CompiledShader {
+    std::string path;
+    std::vector<std::string> defines;
+    std::vector<uint32_t> spirv;
+    ShaderReflection reflection;
+    uint64_t hash = 0;
+    bool fromCache = false;
+
+    vk::ShaderStageFlagBits stage() const
+    {
+        switch (reflection.stage) {
+        case ShaderStageKind::Vertex: return vk::ShaderStageFlagBits::eVertex;
+        case ShaderStageKind::Fragment: return vk::ShaderStageFlagBits::eFragment;
+        case ShaderStageKind::Compute: return vk::ShaderStageFlagBits::eCompute;
+        default: throw std::runtime_error("unsupported shader stage: " + path);
+        }
+    }
+
+    vk::UniqueShaderModule createModule(const vk::UniqueDevice& device) const
+    {
+        return device->createShaderModuleUnique({ {}, spirv.size() * sizeof(uint32_t), spirv.data() });
+    }
+};
+
+class ShaderLibrary {
+public:
+    //root：shader路径的前缀（CMake构建时指向源码目录，热重载改的就是源文件）；cacheDir为空表示不用磁盘缓存
+#ifdef SIMPLE2D_SHADER_ROOT
+    explicit ShaderLibrary(const std::string& root = SIMPLE2D_SHADER_ROOT, const std::string& cacheDir = "shader_cache")
+#else
+    explicit ShaderLibrary(const std::string& root = "", const std::string& cacheDir = "shader_cache")
+#endif
+        : root(root), cacheDir(cacheDir)
+    {
+        if (!cacheDir.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(cacheDir, ec);
+        }
+    }
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    //取一个shader（第一次用时编译或读缓存），多线程安全；编译失败抛异常
+    //defines：形如 "NAME" 或 "NAME=VALUE"，同一个源文件不同宏定义是不同的shader
+    std::shared_ptr<const CompiledShader> get(const std::string& path, const std::vector<std::string>& defines = {})
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string key = makeKey(path, defines);
+        auto it = shaders.find(key);
+        if (it != shaders.end()) return it->second.shader;
+
+        Entry entry;
+        entry.shader = load(path, defines);
+        entry.writeTime = writeTime(path);
+        auto shader = entry.shader;
+        shaders.emplace(key, std::move(entry));
+        return shader;
+    }
+
+    //热重载：返回源文件变过并且重新编译成功的shader路径；编译失败时打印错误，继续用旧的
+    std::vector<std::string> poll()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> changed;
+        for (auto& [key, entry] : shaders) {
+            auto time = writeTime(entry.shader->path);
+            if (time == entry.writeTime) continue;
+            entry.writeTime = time;
+            try {
+                entry.shader = load(entry.shader->path, entry.shader->defines);
+                if (std::find(changed.begin(), changed.end(), entry.shader->path) == changed.end()) changed.push_back(entry.shader->path);
+                std::cout << "[shader] reloaded " << entry.shader->path << std::endl;
+            }
+            catch (const std::exception& e) {
+                std::cout << "[shader] reload of " << entry.shader->path << " failed, keeping the old version:\n" << e.what() << std::endl;
+            }
+        }
+        return changed;
+    }
+
+    uint32_t compiledCount() const { return compiled; }
+    uint32_t cacheHits() const { return cached; }
+
+private:
+    struct Entry {
+        std::shared_ptr<const CompiledShader> shader;
+        std::filesystem::file_time_type writeTime;
+    };
+
+    static std::string makeKey(const std::string& path, const std::vector<std::string>& defines)
+    {
+        std::string key = path;
+        for (auto& d : defines) key += "|" + d;
+        return key;
+    }
+
+    //FNV-1a
+    static uint64_t hashBytes(uint64_t h, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static std::vector<uint32_t> toWords(const std::vector<char>& bytes, const std::string& what)
+    {
+        if (bytes.size() % 4 != 0) throw std::runtime_error("invalid SPIR-V size: " + what);
+        std::vector<uint32_t> words(bytes.size() / 4);
+        memcpy(words.data(), bytes.data(), bytes.size());
+        return words;
+    }
+
+    //被监视的文件：有shaderc时是源码，否则是离线编译的.spv
+    std::string watchedFile(const std::string& path) const
+    {
+#ifdef SIMPLE2D_RUNTIME_SHADERS
+        return root + path;
+#else
+        return root + path + ".spv";
+#endif
+    }
+
+    std::filesystem::file_time_type writeTime(const std::string& path) const
+    {
+        std::error_code ec;
+        return std::filesystem::last_write_time(watchedFile(path), ec);
+    }
+
+    std::shared_ptr<const CompiledShader> load(const std::string& path, const std::vector<std::string>& defines)
+    {
+        PROFILE_SCOPE("ShaderLibrary::load");
+        auto shader = std::make_shared<CompiledShader>();
+        shader->path = path;
+        shader->defines = defines;
+
+#ifdef SIMPLE2D_RUNTIME_SHADERS
+        std::vector<char> source = readFile(root + path);
+        //版本号变了（编译选项改了）缓存自动失效
+        uint64_t h = hashBytes(1469598103934665603ull, "simple2d-shaderc-2", 18);
+        h = hashBytes(h, path.data(), path.size());
+        h = hashBytes(h, source.data(), source.size());
+        for (auto& d : defines) h = hashBytes(h, d.data(), d.size() + 1);
+        shader->hash = h;
+
+        std::ostringstream name;
+        name << std::hex << h << ".spv";
+        std::string cacheFile = cacheDir.empty() ? std::string() : cacheDir + "/" + name.str();
+        std::error_code ec;
+        if (!cacheFile.empty() && std::filesystem::exists(cacheFile, ec)) {
+            shader->spirv = toWords(readFile(cacheFile), cacheFile);
+            shader->fromCache = true;
+            cached++;
+        }
+        else {
+            shader->spirv = compile(path, std::string(source.begin(), source.end()), defines);
+            compiled++;
+            if (!cacheFile.empty()) writeCache(cacheFile, shader->spirv);
+        }
+#else
+        if (!defines.empty()) throw std::runtime_error("shader defines need runtime compilation (shaderc): " + path);
+        std::vector<char> bytes = readFile(root + path + ".spv");
+        shader->hash = hashBytes(1469598103934665603ull, bytes.data(), bytes.size());
+        shader->spirv = toWords(bytes, path);
+#endif
+        shader->reflection = ReflectSpirv(shader->spirv.data(), shader->spirv.size());
+        return shader;
+    }
+
+#ifdef SIMPLE2D_RUNTIME_SHADERS
+    std::vector<uint32_t> compile(const std::string& path, const std::string& source, const std::vector<std::string>& defines) const
+    {
+        shaderc_shader_kind kind;
+        if (path.ends_with(".vert")) kind = shaderc_vertex_shader;
+        else if (path.ends_with(".frag")) kind = shaderc_fragment_shader;
+        else if (path.ends_with(".comp")) kind = shaderc_compute_shader;
+        else throw std::runtime_error("unknown shader stage: " + path);
+
+        shaderc::CompileOptions options;
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+        options.SetOptimizationLevel(shaderc_optimization_level_performance);
+        //优化会去掉OpName，顶点输入按名字和C++字段对应，要保留调试信息
+        options.SetGenerateDebugInfo();
+        for (auto& d : defines) {
+            size_t eq = d.find('=');
+            if (eq == std::string::npos) options.AddMacroDefinition(d);
+            else options.AddMacroDefinition(d.substr(0, eq), d.substr(eq + 1));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        shaderc::Compiler compiler;
+        shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind, path.c_str(), options);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+            throw std::runtime_error(result.GetErrorMessage());
+        std::cout << "[shader] compiled " << path << " in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        return { result.cbegin(), result.cend() };
+    }
+
+    //先写临时文件再改名，写到一半退出也不会留下坏缓存
+    static void writeCache(const std::string& cacheFile, const std::vector<uint32_t>& spirv)
+    {
+        std::string tmpPath = cacheFile + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) return;
+            file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, cacheFile, ec);
+    }
+#endif
+
+    std::string root;
+    std::string cacheDir;
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> shaders;
+    uint32_t compiled = 0;
+    uint32_t cached = 0;
+};
+
+//-----------------由反射生成布局----------------------
+
+//C++侧一个顶点缓冲绑定
+struct VertexStream {
+    uint32_t binding;
+    uint32_t stride;
+    vk::VertexInputRate rate;
+};
+
+//C++结构体里的一个字段，按名字和shader的输入变量对应；format为eUndefined时按shader里的类型推断
+//（需要格式转换的字段要写明，例如RGBA8打包的颜色在shader里是vec4）
+struct VertexField {
+    const char* name;
+    uint32_t binding;
+    uint32_t offset;
+    vk::Format format = vk::Format::eUndefined;
+};
+
+vk::Format InferVertexFormat(const ReflectedInput& input)
+{
+    static const vk::Format floats[4] = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+    static const vk::Format ints[4] = { vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+    static const vk::Format uints[4] = { vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+    if (input.width != 32 || input.components < 1 || input.components > 4)
+        throw std::runtime_error("cannot infer vertex format for " + input.name);
+    const vk::Format* table = input.scalar == ScalarKind::Float ? floats : input.scalar == ScalarKind::Int ? ints : uints;
+    return table[input.components - 1];
+}
+
+//在shader里读出来是整数（uint/int）的格式
+constexpr bool IsIntegerVertexFormat(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eR8Uint: case vk::Format::eR8Sint: case vk::Format::eR8G8Uint: case vk::Format::eR8G8Sint:
+    case vk::Format::eR8G8B8A8Uint: case vk::Format::eR8G8B8A8Sint:
+    case vk::Format::eR16Uint: case vk::Format::eR16Sint: case vk::Format::eR16G16Uint: case vk::Format::eR16G16Sint:
+    case vk::Format::eR16G16B16A16Uint: case vk::Format::eR16G16B16A16Sint:
+    case vk::Format::eR32Uint: case vk::Format::eR32Sint: case vk::Format::eR32G32Uint: case vk::Format::eR32G32Sint:
+    case vk::Format::eR32G32B32Uint: case vk::Format::eR32G32B32Sint: case vk::Format::eR32G32B32A32Uint: case vk::Format::eR32G32B32A32Sint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//顶点着色器的每个输入都必须在fields里找到同名字段，找不到抛异常；shader没用到的字段不生成属性
+void MakeVertexInput(
+    const ShaderReflection& vertex,
+    const std::vector<VertexStream>& streams,
+    const std::vector<VertexField>& fields,
+    std::vector<vk::VertexInputBindingDescription>& bindings,
+    std::vector<vk::VertexInputAttributeDescription>& attributes)
+{
+    bindings.clear();
+    attributes.clear();
+    for (auto& s : streams) bindings.emplace_back(s.binding, s.stride, s.rate);
+    for (const ReflectedInput& input : vertex.inputs) {
+        auto field = std::find_if(fields.begin(), fields.end(), [&](const VertexField& f) { return input.name == f.name; });
+        if (field == fields.end())
+            throw std::runtime_error("vertex shader input '" + input.name + "' (location " + std::to_string(input.location) +
+                ") has no matching C++ field" + (input.name.empty() ? " (SPIR-V has no debug names)" : ""));
+        vk::Format format = field->format != vk::Format::eUndefined ? field->format : InferVertexFormat(input);
+        if (IsIntegerVertexFormat(format) != (input.scalar != ScalarKind::Float))
+            throw std::runtime_error("vertex shader input '" + input.name + "': format does not match the shader type");
+        attributes.emplace_back(input.location, field->binding, format, field->offset);
+    }
+}
+
+vk::DescriptorType ToDescriptorType(DescriptorKind kind)
+{
+    switch (kind) {
+    case DescriptorKind::UniformBuffer: return vk::DescriptorType::eUniformBuffer;
+    case DescriptorKind::StorageBuffer: return vk::DescriptorType::eStorageBuffer;
+    case DescriptorKind::CombinedImageSampler: return vk::DescriptorType::eCombinedImageSampler;
+    case DescriptorKind::SampledImage: return vk::DescriptorType::eSampledImage;
+    case DescriptorKind::StorageImage: return vk::DescriptorType::eStorageImage;
+    case DescriptorKind::Sampler: return vk::DescriptorType::eSampler;
+    case DescriptorKind::UniformTexelBuffer: return vk::DescriptorType::eUniformTexelBuffer;
+    case DescriptorKind::StorageTexelBuffer: return vk::DescriptorType::eStorageTexelBuffer;
+    case DescriptorKind::InputAttachment: return vk::DescriptorType::eInputAttachment;
+    }
+    return vk::DescriptorType::eUniformBuffer;
+}
+
+//合并多个阶段里同一个set的绑定（同一个binding出现在多个阶段时合并stageFlags，类型不一致抛异常）
+//运行时数组的数量取runtimeArrayCount（bindless的set通常自己建布局，见 BindlessTextures）
+std::vector<vk::DescriptorSetLayoutBinding> MakeSetLayoutBindings(
+    const std::vector<const CompiledShader*>& shaders,
+    uint32_t set,
+    uint32_t runtimeArrayCount = 1)
+{
+    std::vector<vk::DescriptorSetLayoutBinding> result;
+    for (const CompiledShader* shader : shaders) {
+        for (const ReflectedBinding& b : shader->reflection.bindings) {
+            if (b.set != set) continue;
+            vk::DescriptorType type = ToDescriptorType(b.kind);
+            uint32_t count = b.count == 0 ? runtimeArrayCount : b.count;
+            auto it = std::find_if(result.begin(), result.end(), [&](const vk::DescriptorSetLayoutBinding& r) { return r.binding == b.binding; });
+            if (it == result.end()) {
+                result.emplace_back(b.binding, type, count, shader->stage());
+                continue;
+            }
+            if (it->descriptorType != type || it->descriptorCount != count)
+                throw std::runtime_error("set " + std::to_string(set) + " binding " + std::to_string(b.binding) + " differs between shader stages");
+            it->stageFlags |= shader->stage();
+        }
+    }
+    return result;
+}
+
+//每个用到push constant的阶段一个范围（从0开始，大小取反射出的大小）
+std::vector<vk::PushConstantRange> MakePushConstantRanges(const std::vector<const CompiledShader*>& shaders)
+{
+    std::vector<vk::PushConstantRange> ranges;
+    for (const CompiledShader* shader : shaders) {
+        if (shader->reflection.pushConstantSize > 0)
+            ranges.emplace_back(shader->stage(), 0, shader->reflection.pushConstantSize);
+    }
+    return ranges;
+}
+
+//检查shader里某个绑定是不是预期的类型（C++自己建布局的set，比如bindless贴图数组，用它确认和shader一致）
+void ExpectBinding(const CompiledShader& shader, uint32_t set, uint32_t binding, DescriptorKind kind, bool runtimeArray)
+{
+    for (const ReflectedBinding& b : shader.reflection.bindings) {
+        if (b.set != set || b.binding != binding) continue;
+        if (b.kind != kind || (b.count == 0) != runtimeArray)
+            throw std::runtime_error(shader.path + ": set " + std::to_string(set) + " binding " + std::to_string(binding) + " does not match the C++ layout");
+        return;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "SpriteBatch.h"    // PackHalf / PackAngle / PackColor
+#include "SpatialGrid.h"    // Bounds2D
+
+//-----------------SDF图形----------------------
+//圆、圆角矩形、胶囊（线段）、圆环和描边：每个图形都是一个实例化的正方形（4个顶点），
+//形状参数跟着实例走，shape.frag 按有向距离场算覆盖率，边缘解析抗锯齿
+//图表、UI这类东西整批一次draw，CPU不用三角化；画在精灵之后，不参与排序和GPU剔除
+//坐标是按宽高比修正过的：y和NDC一样是[-1,1]，x是[-aspect, aspect]（aspect = 宽/高），两个方向一个单位一样多像素，
+//圆在非正方形窗口里还是圆；shape.vert 最后再把x除以aspect换回NDC
+
+enum class ShapeType : uint16_t {
+    Circle = 0,     // 半径 = halfSize[0]
+    RoundedRect,    // 半宽高 = halfSize，圆角半径 = params[0]
+    Capsule         // 沿本地x轴的线段，两端半圆，半径 = halfSize[1]
+};
+
+// 实例数据：布局必须和 shape.vert 的输入一致（见 Scene.h 的 VertexLayout<ShapeInstance>）
+struct ShapeInstance {
+    float center[2];
+    float halfSize[2];      // 图形本身的半宽高（本地坐标，旋转之前）
+    uint16_t rotation;      // PackAngle
+    uint16_t type;          // ShapeType
+    uint16_t params[2];     // half：圆角半径、描边宽度（0表示填充）
+    uint32_t color;         // RGBA8，低字节是R
+    uint16_t aa;            // half：抗锯齿过渡带宽度（像素）
+    uint16_t pad;
+};
+static_assert(sizeof(ShapeInstance) == 32, "ShapeInstance must match the inputs of shape.vert");
+
+//NDC里的保守包围盒（旋转后取外接圆），脏矩形用；抗锯齿过渡带由 DamageTracker 的Padding覆盖
+Bounds2D ShapeBounds(const ShapeInstance& s, float aspect)
+{
+    float r = std::sqrt(s.halfSize[0] * s.halfSize[0] + s.halfSize[1] * s.halfSize[1]);
+    return Bounds2D::FromCenter(s.center[0] / aspect, s.center[1], r / aspect, r);
+}
+
+//填充/描边样式
+struct ShapeStyle {
+    uint32_t color = PackColor(255, 255, 255);
+    float stroke = 0.0f;    // 描边宽度（世界单位），只画边界内侧这么宽的一圈；0表示填充
+    float aa = 1.0f;        // 抗锯齿过渡带宽度（像素）
+};
+
+class ShapeBatch {
+public:
+    //aspect = 目标的宽/高，这一批的x坐标范围是[-aspect, aspect]
+    void begin(float aspect)
+    {
+        shapes.clear();
+        currentAspect = aspect;
+    }
+    float aspect() const { return currentAspect; }
+
+    void drawCircle(float x, float y, float radius, const ShapeStyle& style = {})
+    {
+        push(ShapeType::Circle, x, y, radius, radius, 0.0f, 0.0f, style);
+    }
+
+    //圆环：radius是环的中线半径
+    void drawRing(float x, float y, float radius, float thickness, uint32_t color, float aa = 1.0f)
+    {
+        float outer = radius + thickness * 0.5f;
+        push(ShapeType::Circle, x, y, outer, outer, 0.0f, 0.0f, { color, thickness, aa });
+    }
+
+    void drawRoundedRect(float x, float y, float halfWidth, float halfHeight, float cornerRadius, const ShapeStyle& style = {},
+        float rotation = 0.0f)
+    {
+        push(ShapeType::RoundedRect, x, y, halfWidth, halfHeight, cornerRadius, rotation, style);
+    }
+
+    //线段(x0,y0)-(x1,y1)，两端是半圆
+    void drawLine(float x0, float y0, float x1, float y1, float width, const ShapeStyle& style = {})
+    {
+        float dx = x1 - x0, dy = y1 - y0;
+        float halfWidth = width * 0.5f;
+        float halfLength = 0.5f * std::sqrt(dx * dx + dy * dy);
+        push(ShapeType::Capsule, (x0 + x1) * 0.5f, (y0 + y1) * 0.5f, halfLength + halfWidth, halfWidth, 0.0f, std::atan2(dy, dx), style);
+    }
+
+    uint32_t size() const { return (uint32_t)shapes.size(); }
+    const std::vector<ShapeInstance>& instances() const { return shapes; }
+
+    //按提交顺序写进dst（一般是图形环形缓冲里本帧的那一段），后提交的画在上面
+    void end(ShapeInstance* dst) const
+    {
+        if (!shapes.empty()) memcpy(dst, shapes.data(), shapes.size() * sizeof(ShapeInstance));
+    }
+
+private:
+    void push(ShapeType type, float x, float y, float halfWidth, float halfHeight, float cornerRadius, float rotation, const ShapeStyle& style)
+    {
+        ShapeInstance s;
+        s.center[0] = x;
+        s.center[1] = y;
+        s.halfSize[0] = halfWidth;
+        s.halfSize[1] = halfHeight;
+        s.rotation = PackAngle(rotation);
+        s.type = (uint16_t)type;
+        s.params[0] = PackHalf(cornerRadius);
+        s.params[1] = PackHalf(style.stroke);
+        s.color = style.color;
+        s.aa = PackHalf(style.aa);
+        s.pad = 0;
+        shapes.push_back(s);
+    }
+
+    std::vector<ShapeInstance> shapes;
+    float currentAspect = 1.0f;
+};
+
+//目标大小 -> ShapeBatch::begin 的aspect
+float ShapeAspect(uint32_t width, uint32_t height)
+{
+    return height ? (float)width / (float)height : 1.0f;
+}
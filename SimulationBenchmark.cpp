@@ -0,0 +1,367 @@
+#include "SpriteSimulation.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+
+//-----------------精灵模拟微基准----------------------
+//只测CPU：同样的运动规则，对比"标量 + AoS"（每个精灵一个结构体）和 SpriteSimulation 的 SoA 各套内核，
+//以及多线程的吞吐（百万精灵/秒）。输出写进普通内存，模拟写进映射的实例缓冲
+//再用同一批精灵测空间索引（SpatialGrid）：建立、增量更新、拾取、矩形查询、最近邻和收集可见子集，结果和暴力扫描对照
+//不需要Vulkan，任何机器都能跑
+
+#ifndef SIMPLE2D_COMMIT
+#define SIMPLE2D_COMMIT "unknown"   // CMake配置时填入git提交号
+#endif
+
+struct SimBenchOptions {
+    uint32_t count = 1000000;           // --count N
+    uint32_t warmup = 10;               // --warmup N
+    uint32_t frames = 100;              // --frames N
+    uint32_t threads = 0;               // --threads N（多线程那一项的总线程数，0表示按CPU核数）
+    std::string jsonPath;               // --json PATH（不填则只打印）
+    bool help = false;                  // --help
+};
+
+const char* SIM_BENCH_USAGE =
+    "usage: Simple2DSimBenchmark [--count N] [--warmup N] [--frames N] [--threads N] [--json PATH]\n";
+
+//非负整数参数；不是数字（或后面还有别的字符）时抛异常
+uint32_t ParseUintArg(const std::string& name, const std::string& value)
+{
+    size_t used = 0;
+    unsigned long v = 0;
+    try {
+        if (!value.empty() && value[0] != '-') v = std::stoul(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || v > UINT32_MAX) throw std::runtime_error("invalid value for " + name + ": " + value);
+    return (uint32_t)v;
+}
+
+SimBenchOptions ParseSimBenchOptions(int argc, char** argv)
+{
+    SimBenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) opt.count = std::max(ParseUintArg(arg, argv[++i]), 1u);
+        else if (arg == "--warmup" && i + 1 < argc) opt.warmup = ParseUintArg(arg, argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) opt.frames = std::max(ParseUintArg(arg, argv[++i]), 1u);
+        else if (arg == "--threads" && i + 1 < argc) opt.threads = ParseUintArg(arg, argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) opt.jsonPath = argv[++i];
+        else if (arg == "--help" || arg == "-h") opt.help = true;
+        else throw std::runtime_error("unknown argument: " + arg);
+    }
+    return opt;
+}
+
+//对照组：典型的"一个精灵一个结构体"写法，规则和 SpriteSimulation 相同
+struct SpriteAoS {
+    float x, y, velX, velY;
+    float rotation, spin;
+    float baseScale, phase, pulseRate;
+    uint32_t color, region;
+};
+
+void UpdateAoS(std::vector<SpriteAoS>& sprites, float bounds, float dt, InstanceData* dst)
+{
+    const float pi = 3.14159265f, twoPi = 6.28318531f;
+    for (size_t i = 0; i < sprites.size(); ++i) {
+        SpriteAoS& s = sprites[i];
+        s.x += s.velX * dt;
+        s.y += s.velY * dt;
+        if (s.x > bounds) { s.x = 2.0f * bounds - s.x; s.velX = -s.velX; }
+        else if (s.x < -bounds) { s.x = -2.0f * bounds - s.x; s.velX = -s.velX; }
+        if (s.y > bounds) { s.y = 2.0f * bounds - s.y; s.velY = -s.velY; }
+        else if (s.y < -bounds) { s.y = -2.0f * bounds - s.y; s.velY = -s.velY; }
+        s.rotation += s.spin * dt;
+        if (s.rotation > pi) s.rotation -= twoPi;
+        else if (s.rotation < -pi) s.rotation += twoPi;
+        s.phase += s.pulseRate * dt;
+        if (s.phase >= 1.0f) s.phase -= 1.0f;
+        float scale = s.baseScale * (0.75f + 0.5f * std::fabs(2.0f * s.phase - 1.0f));
+
+        InstanceData& d = dst[i];
+        d.offset[0] = PackHalf(s.x);
+        d.offset[1] = PackHalf(s.y);
+        d.scale[0] = d.scale[1] = PackHalf(scale);
+        d.rotation = PackAngle(s.rotation);
+        d.region = (uint16_t)s.region;
+        d.color = s.color;
+    }
+}
+
+std::vector<SpriteAoS> ToAoS(const SpriteSoA& s)
+{
+    std::vector<SpriteAoS> out(s.posX.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = { s.posX[i], s.posY[i], s.velX[i], s.velY[i], s.rotation[i], s.spin[i], s.baseScale[i], s.phase[i], s.pulseRate[i],
+            s.color[i], s.region[i] };
+    }
+    return out;
+}
+
+struct SimBenchResult {
+    std::string name;
+    double msPerFrame = 0.0;
+    double mspritesPerSec = 0.0;
+    bool matches = true;    // 输出是否和AoS对照组逐位相同
+};
+
+const float SIM_DT = 1.0f / 60.0f;
+
+struct SpatialBenchResult {
+    std::string name;
+    double msPerOp = 0.0;
+    bool matches = true;    // 结果是否和暴力扫描相同
+};
+
+//确定性的随机查询点
+struct QueryPoints {
+    std::vector<float> x, y;
+    QueryPoints(uint32_t count, float bounds)
+    {
+        uint32_t state = 12345;
+        auto next = [&state] {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        };
+        for (uint32_t i = 0; i < count; ++i) {
+            x.push_back((next() * 2.0f - 1.0f) * bounds);
+            y.push_back((next() * 2.0f - 1.0f) * bounds);
+        }
+    }
+};
+
+template<typename Fn>
+double TimeMs(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<SpatialBenchResult> RunSpatialBench(const SimBenchOptions& opt, const SpriteSimulation& prototype, JobSystem* jobs)
+{
+    std::vector<SpatialBenchResult> results;
+    const uint32_t queries = 1000;
+    float bounds = prototype.worldBounds();
+    QueryPoints points(queries, bounds);
+    SpatialGrid grid(SPRITE_GRID_CELL);
+
+    //暴力扫描作为对照
+    std::vector<Bounds2D> boxes(prototype.size());
+    for (uint32_t i = 0; i < prototype.size(); ++i) boxes[i] = prototype.spriteBounds(i);
+    auto brutePick = [&](float x, float y) {
+        uint32_t best = SpatialGrid::None;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+            if (boxes[i].contains(x, y)) best = i;
+        return best;
+    };
+    auto bruteNearest = [&](float x, float y) {
+        uint32_t best = SpatialGrid::None;
+        float bestD = 0.0f;
+        for (uint32_t i = 0; i < boxes.size(); ++i) {
+            float d = boxes[i].distanceSquared(x, y);
+            if (best == SpatialGrid::None || d <= bestD) { best = i; bestD = d; }
+        }
+        return best;
+    };
+    const uint32_t checks = 50;     // 暴力扫描很慢，只对照前几个查询
+
+    {
+        SpatialBenchResult r{ "build" };
+        r.msPerOp = TimeMs([&] { prototype.updateGrid(grid); });
+        r.matches = grid.size() == prototype.size();
+        results.push_back(r);
+    }
+    {
+        //编辑器里的常见情况：每帧只有少数实例在动（这里是1%），只把它们更新进网格
+        SpatialBenchResult r{ "update/1%" };
+        uint32_t stride = 100;
+        double total = 0.0;
+        for (uint32_t f = 0; f < opt.frames; ++f) {
+            float dx = 0.01f * ((f & 1) ? -1.0f : 1.0f);
+            total += TimeMs([&] {
+                for (uint32_t i = f % stride; i < boxes.size(); i += stride) {
+                    Bounds2D& b = boxes[i];
+                    b = { b.minX + dx, b.minY + dx, b.maxX + dx, b.maxY + dx };
+                    grid.update(i, b);
+                }
+            });
+        }
+        r.msPerOp = total / opt.frames;
+        results.push_back(r);
+    }
+    {
+        SpatialBenchResult r{ "pick" };
+        std::vector<uint32_t> picked(queries);
+        r.msPerOp = TimeMs([&] { for (uint32_t q = 0; q < queries; ++q) picked[q] = grid.pick(points.x[q], points.y[q]); }) / queries;
+        for (uint32_t q = 0; q < checks; ++q) r.matches &= picked[q] == brutePick(points.x[q], points.y[q]);
+        results.push_back(r);
+    }
+    {
+        SpatialBenchResult r{ "nearest" };
+        std::vector<uint32_t> found(queries);
+        //查询点放到世界外面一点，大部分不在任何精灵里，要真的往外找
+        r.msPerOp = TimeMs([&] { for (uint32_t q = 0; q < queries; ++q) found[q] = grid.nearest(points.x[q] * 1.2f, points.y[q] * 1.2f); }) / queries;
+        for (uint32_t q = 0; q < checks; ++q) r.matches &= found[q] == bruteNearest(points.x[q] * 1.2f, points.y[q] * 1.2f);
+        results.push_back(r);
+    }
+    {
+        //相机只看到世界的10%：收集可见子集并只拷贝这些实例（代替每帧上传全部）
+        SpatialBenchResult r{ "visible/10%" };
+        float half = bounds * std::sqrt(0.1f);
+        std::vector<uint32_t> visible;
+        std::vector<Bounds2D> upload(boxes.size());
+        double total = 0.0;
+        for (uint32_t f = 0; f < opt.frames; ++f) {
+            float cx = points.x[f % queries] * (bounds - half) / bounds, cy = points.y[f % queries] * (bounds - half) / bounds;
+            Bounds2D view = Bounds2D::FromCenter(cx, cy, half, half);
+            total += TimeMs([&] {
+                grid.gatherVisible(view, visible);
+                for (size_t i = 0; i < visible.size(); ++i) upload[i] = boxes[visible[i]];
+            });
+            if (f < checks) {
+                uint32_t expected = 0;
+                for (const Bounds2D& b : boxes) expected += b.overlaps(view) ? 1 : 0;
+                r.matches &= expected == visible.size();
+            }
+        }
+        r.msPerOp = total / opt.frames;
+        results.push_back(r);
+    }
+    {
+        //每帧模拟全部精灵、同一趟里同步网格、只写出10%视口里的：和全部写出再按包围盒过滤的结果对照
+        SpatialBenchResult r{ "simulate+visible/10%" };
+        float half = bounds * std::sqrt(0.1f);
+        Bounds2D view = Bounds2D::FromCenter(0.0f, 0.0f, half, half);
+        SpriteSimulation sim = prototype, reference = prototype;
+        SpatialGrid simGrid(SPRITE_GRID_CELL);
+        AlignedVector<InstanceData> visible(prototype.size()), all(prototype.size());
+        sim.updateVisible(SIM_DT, visible.data(), simGrid, view, jobs);     // 第一次要登记全部精灵，不计时
+        reference.update(SIM_DT, all.data(), jobs);
+        double total = 0.0;
+        for (uint32_t f = 0; f < opt.frames; ++f) {
+            uint32_t count = 0;
+            total += TimeMs([&] { count = sim.updateVisible(SIM_DT, visible.data(), simGrid, view, jobs); });
+            reference.update(SIM_DT, all.data(), jobs);
+            if (f < checks) {
+                uint32_t k = 0;
+                for (uint32_t i = 0; i < reference.size(); ++i) {
+                    if (!reference.spriteBounds(i).overlaps(view)) continue;
+                    r.matches &= k < count && memcmp(&visible[k], &all[i], sizeof(InstanceData)) == 0;
+                    k++;
+                }
+                r.matches &= k == count;
+            }
+        }
+        r.msPerOp = total / opt.frames;
+        results.push_back(r);
+    }
+    return results;
+}
+
+//跑warmup + frames帧，返回每帧平均毫秒
+template<typename Fn>
+double TimeFrames(const SimBenchOptions& opt, Fn step)
+{
+    for (uint32_t f = 0; f < opt.warmup; ++f) step();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < opt.frames; ++f) step();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / opt.frames;
+}
+
+int main(int argc, char** argv)
+{
+    SimBenchOptions opt;
+    try {
+        opt = ParseSimBenchOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n" << SIM_BENCH_USAGE;
+        return 2;
+    }
+    if (opt.help) {
+        std::cout << SIM_BENCH_USAGE;
+        return 0;
+    }
+    uint32_t threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    SpriteSimulation prototype(1.0f);
+    SpawnRandomSprites(prototype, opt.count, {});
+    AlignedVector<InstanceData> reference(opt.count), output(opt.count);
+    std::vector<SimBenchResult> results;
+
+    //对照组的结果也作为正确性检查的基准（所有内核从同样的初始状态走同样的帧数）
+    {
+        std::vector<SpriteAoS> sprites = ToAoS(prototype.state());
+        SimBenchResult r;
+        r.name = "aos/scalar";
+        r.msPerFrame = TimeFrames(opt, [&] { UpdateAoS(sprites, prototype.worldBounds(), SIM_DT, reference.data()); });
+        results.push_back(r);
+    }
+
+    auto runSoA = [&](const std::string& name, SimdLevel level, JobSystem* jobs) {
+        if (level > BestSimdLevel()) return;
+        SpriteSimulation sim = prototype;
+        sim.setSimdLevel(level);
+        SimBenchResult r;
+        r.name = name;
+        r.msPerFrame = TimeFrames(opt, [&] { sim.update(SIM_DT, output.data(), jobs); });
+        r.matches = memcmp(reference.data(), output.data(), sizeof(InstanceData) * opt.count) == 0;
+        results.push_back(r);
+    };
+    runSoA("soa/scalar", SimdLevel::Scalar, nullptr);
+    runSoA("soa/sse2", SimdLevel::SSE2, nullptr);
+    runSoA("soa/avx2", SimdLevel::AVX2, nullptr);
+    std::vector<SpatialBenchResult> spatial;
+    {
+        JobSystem jobs(threads - 1);
+        runSoA(std::string("soa/") + SimdLevelName(BestSimdLevel()) + "/threads" + std::to_string(threads), BestSimdLevel(), &jobs);
+        spatial = RunSpatialBench(opt, prototype, &jobs);
+    }
+
+    std::cout << "[simulation] " << opt.count << " sprites, " << opt.frames << " frames" << std::endl;
+    double baseline = results[0].msPerFrame;
+    for (SimBenchResult& r : results) {
+        r.mspritesPerSec = opt.count / (r.msPerFrame / 1000.0) / 1e6;
+        std::cout << "  " << r.name << ": " << r.msPerFrame << " ms/frame, " << r.mspritesPerSec << " Msprites/s, x"
+            << baseline / r.msPerFrame << (r.matches ? "" : "  (OUTPUT MISMATCH)") << std::endl;
+    }
+
+    std::cout << "[spatial] grid cell " << SPRITE_GRID_CELL << std::endl;
+    for (const SpatialBenchResult& r : spatial) {
+        std::cout << "  " << r.name << ": " << r.msPerOp << " ms/op" << (r.matches ? "" : "  (RESULT MISMATCH)") << std::endl;
+    }
+
+    if (!opt.jsonPath.empty()) {
+        std::ostringstream out;
+        out << "{\n  \"commit\": \"" << SIMPLE2D_COMMIT << "\",\n  \"sprites\": " << opt.count << ",\n  \"frames\": " << opt.frames
+            << ",\n  \"kernels\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const SimBenchResult& r = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"msPerFrame\": " << r.msPerFrame
+                << ", \"mspritesPerSec\": " << r.mspritesPerSec << ", \"matches\": " << (r.matches ? "true" : "false") << "}";
+        }
+        out << "\n  ],\n  \"spatial\": [";
+        for (size_t i = 0; i < spatial.size(); ++i) {
+            const SpatialBenchResult& r = spatial[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"msPerOp\": " << r.msPerOp
+                << ", \"matches\": " << (r.matches ? "true" : "false") << "}";
+        }
+        out << "\n  ]\n}\n";
+        std::ofstream(opt.jsonPath) << out.str();
+        std::cout << "[simulation] results written to " << opt.jsonPath << std::endl;
+    }
+    for (const SimBenchResult& r : results) {
+        if (!r.matches) return 1;
+    }
+    for (const SpatialBenchResult& r : spatial) {
+        if (!r.matches) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,342 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <bit>
+
+//-----------------空间索引----------------------
+//实例包围盒的均匀哈希网格（松散网格）：每个实例只按包围盒中心放进一个格子，
+//查询时把范围向外扩"登记过的最大半宽高"，大小不一的实例也不用跨格子登记
+//中心离开格子半格以内还留在原来的格子里（查询再多扩半格），来回穿过格子边界的实例不用反复换格子
+//包围盒和id分成两个数组连续存在格子里，查询时顺序扫格子，不随机访问按id排的数组；内部格子只读id
+//插入、移动、删除都是O(1)（中心没换格子时只改包围盒）；格子按坐标哈希，世界没有边界
+//支持点拾取、矩形查询、最近邻，以及给相机矩形收集可见子集（只上传可见的实例）
+//矩形查询时，中心范围（格子再扩slack）整个落在矩形里的格子不用逐个测包围盒，只有边上那一圈格子要测
+//每帧都在动的实例可以在各自的任务里并行 updateInPlace，换了格子的再在一个线程上 insert
+
+//轴对齐包围盒
+struct Bounds2D {
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+
+    static Bounds2D FromCenter(float x, float y, float halfWidth, float halfHeight)
+    {
+        return { x - halfWidth, y - halfHeight, x + halfWidth, y + halfHeight };
+    }
+    bool overlaps(const Bounds2D& o) const { return minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY; }
+    bool contains(float x, float y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+    //点到包围盒的距离的平方（在里面为0）
+    float distanceSquared(float x, float y) const
+    {
+        float dx = std::max({ minX - x, 0.0f, x - maxX });
+        float dy = std::max({ minY - y, 0.0f, y - maxY });
+        return dx * dx + dy * dy;
+    }
+};
+
+class SpatialGrid {
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    //cellSize 取常见实例大小的1~2倍：太小时查询要扫很多格子，太大时每个格子里实例太多
+    explicit SpatialGrid(float cellSize) : cellSize(cellSize), inverseCell(1.0f / cellSize), slack(cellSize * 0.5f) {}
+
+    //id由调用者给（一般就是实例下标），不必连续；已经在网格里时等同于 update
+    void insert(uint32_t id, const Bounds2D& bounds)
+    {
+        if (id >= entries.size()) entries.resize((size_t)id + 1);
+        if (entries[id].cell != None) {
+            update(id, bounds);
+            return;
+        }
+        growExtent(bounds);
+        link(id, bounds, cellOf(bounds));
+        count++;
+    }
+
+    //实例移动或改变大小（id必须已经在网格里）
+    void update(uint32_t id, const Bounds2D& bounds)
+    {
+        Entry& e = entries[id];
+        growExtent(bounds);
+        //大多数时候中心还在原来的格子附近，不用查哈希表
+        if (staysIn(e, bounds)) {
+            cells[e.cell].bounds[e.slot] = bounds;
+            return;
+        }
+        unlink(id);
+        link(id, bounds, cellOf(bounds));
+    }
+
+    //只在不用换格子、大小不超过登记过的最大半宽高时就地改包围盒，否则什么都不做、返回false（要再调用 insert）
+    //只写这个id自己的那一项：不同的id可以在多个线程上同时调用（期间不能有别的修改）
+    bool updateInPlace(uint32_t id, const Bounds2D& bounds)
+    {
+        if (!contains(id)) return false;
+        const Entry& e = entries[id];
+        if (!staysIn(e, bounds)) return false;
+        if ((bounds.maxX - bounds.minX) * 0.5f > maxHalf[0] || (bounds.maxY - bounds.minY) * 0.5f > maxHalf[1]) return false;
+        cells[e.cell].bounds[e.slot] = bounds;
+        return true;
+    }
+
+    void remove(uint32_t id)
+    {
+        if (!contains(id)) return;
+        unlink(id);
+        entries[id].cell = None;
+        count--;
+    }
+
+    void clear()
+    {
+        entries.clear();
+        cells.clear();
+        lookup.clear();
+        count = 0;
+        maxHalf[0] = maxHalf[1] = 0.0f;
+        cellMin[0] = cellMin[1] = INT32_MAX;
+        cellMax[0] = cellMax[1] = INT32_MIN;
+    }
+
+    bool contains(uint32_t id) const { return id < entries.size() && entries[id].cell != None; }
+    uint32_t size() const { return count; }
+    const Bounds2D& bounds(uint32_t id) const { return cells[entries[id].cell].bounds[entries[id].slot]; }
+
+    //包围盒和rect相交的每个实例调用一次 visit(id)，顺序不固定
+    template<typename Fn>
+    void queryRect(const Bounds2D& rect, Fn&& visit) const
+    {
+        forEachCandidate(rect,
+            [&](const Cell& cell) { for (uint32_t id : cell.ids) visit(id); },
+            [&](const Bounds2D& b, uint32_t id) { if (b.overlaps(rect)) visit(id); });
+    }
+
+    //相机矩形里的可见子集，按id升序写进out（上传时按原来的顺序拷贝，画的前后关系不变）
+    //先在位图里做标记再按位扫出来，比排序快，代价是每次扫 id上限/64 个字；内部格子整格标记，不测包围盒
+    void gatherVisible(const Bounds2D& view, std::vector<uint32_t>& out) const
+    {
+        visibleBits.assign((entries.size() + 63) / 64, 0);
+        size_t visible = 0;
+        auto mark = [&](uint32_t id) { visibleBits[id >> 6] |= 1ull << (id & 63); };
+        forEachCandidate(view,
+            [&](const Cell& cell) {
+                for (uint32_t id : cell.ids) mark(id);
+                visible += cell.ids.size();
+            },
+            [&](const Bounds2D& b, uint32_t id) {
+                if (!b.overlaps(view)) return;
+                mark(id);
+                visible++;
+            });
+        out.resize(visible);
+        uint32_t* dst = out.data();
+        for (size_t w = 0; w < visibleBits.size(); ++w) {
+            for (uint64_t bits = visibleBits[w]; bits; bits &= bits - 1)
+                *dst++ = (uint32_t)(w * 64 + std::countr_zero(bits));
+        }
+    }
+
+    //包围盒包含(x,y)的每个实例调用一次 visit(id)
+    template<typename Fn>
+    void queryPoint(float x, float y, Fn&& visit) const
+    {
+        Bounds2D point{ x, y, x, y };
+        //点没有内部格子，每个候选都要测
+        forEachCandidate(point,
+            [&](const Cell& cell) { for (size_t i = 0; i < cell.ids.size(); ++i) if (cell.bounds[i].contains(x, y)) visit(cell.ids[i]); },
+            [&](const Bounds2D& b, uint32_t id) { if (b.contains(x, y)) visit(id); });
+    }
+
+    //点拾取：包含(x,y)的实例里id最大的那个（同一层里后提交的画在上面），没有时返回None
+    uint32_t pick(float x, float y) const
+    {
+        uint32_t best = None;
+        queryPoint(x, y, [&](uint32_t id) {
+            if (best == None || id > best) best = id;
+        });
+        return best;
+    }
+
+    //最近邻：包围盒离(x,y)最近的实例（点在包围盒里时距离为0），超过maxDistance返回None
+    //从点所在的格子一圈圈往外找，剩下的格子不可能更近时停止；格子很稀疏时直接遍历全部
+    uint32_t nearest(float x, float y, float maxDistance = std::numeric_limits<float>::infinity()) const
+    {
+        if (count == 0) return None;
+        float best = maxDistance * maxDistance;
+        uint32_t bestId = None;
+        auto consider = [&](const Cell& cell) {
+            for (size_t i = 0; i < cell.ids.size(); ++i) {
+                //距离相同时和 pick 一样取id大的
+                float d = cell.bounds[i].distanceSquared(x, y);
+                uint32_t id = cell.ids[i];
+                if (bestId == None ? d <= best : (d < best || (d == best && id > bestId))) {
+                    best = d;
+                    bestId = id;
+                }
+            }
+        };
+        auto visitCell = [&](int64_t gx, int64_t gy) {
+            if (gx < cellMin[0] || gx > cellMax[0] || gy < cellMin[1] || gy > cellMax[1]) return;
+            if (const Cell* cell = findCell(gx, gy)) consider(*cell);
+        };
+
+        int64_t cx = coord(x), cy = coord(y);
+        float reach = std::sqrt(maxHalf[0] * maxHalf[0] + maxHalf[1] * maxHalf[1]);
+        //这一圈之前没有登记过的格子，超过最后一圈就已经全部看过了
+        int64_t firstRing = std::max({ (int64_t)0, cellMin[0] - cx, cx - cellMax[0], cellMin[1] - cy, cy - cellMax[1] });
+        int64_t lastRing = std::max({ cx - cellMin[0], cellMax[0] - cx, cy - cellMin[1], cellMax[1] - cy });
+        uint64_t scanned = 0;
+        for (int64_t ring = firstRing; ring <= lastRing; ++ring) {
+            //第ring圈格子里的中心离点至少 (ring-1)*cellSize - slack，包围盒再近也近不过 reach
+            float bound = std::max((ring - 1) * cellSize - slack - reach, 0.0f);
+            if (bound * bound > best) break;
+            scanned += ring ? 8 * (uint64_t)ring : 1;
+            if (scanned > 4 * (uint64_t)cells.size()) {
+                for (const Cell& cell : cells) consider(cell);
+                return bestId;
+            }
+            if (ring == 0) {
+                visitCell(cx, cy);
+                continue;
+            }
+            for (int64_t i = -ring; i <= ring; ++i) {
+                visitCell(cx + i, cy - ring);
+                visitCell(cx + i, cy + ring);
+            }
+            for (int64_t i = -ring + 1; i <= ring - 1; ++i) {
+                visitCell(cx - ring, cy + i);
+                visitCell(cx + ring, cy + i);
+            }
+        }
+        return bestId;
+    }
+
+private:
+    struct Entry {
+        uint32_t cell = None;   // cells里的下标，None表示不在网格里
+        uint32_t slot = 0;      // 在 cell.ids/bounds 里的位置，删除时和最后一个交换
+        int32_t x = 0, y = 0;   // 格子坐标（和cells里的一样，判断要不要换格子时不用去读格子）
+    };
+    struct Cell {
+        int32_t x = 0, y = 0;
+        std::vector<Bounds2D> bounds;
+        std::vector<uint32_t> ids;
+    };
+
+    static float centerX(const Bounds2D& b) { return (b.minX + b.maxX) * 0.5f; }
+    static float centerY(const Bounds2D& b) { return (b.minY + b.maxY) * 0.5f; }
+
+    static uint64_t key(int64_t gx, int64_t gy) { return ((uint64_t)(uint32_t)gx << 32) | (uint32_t)gy; }
+
+    int32_t coord(float v) const
+    {
+        float c = std::floor(v * inverseCell);
+        return (int32_t)std::clamp(c, -2147483520.0f, 2147483520.0f);
+    }
+
+    //按包围盒中心定格子，第一次用到的格子才分配
+    uint32_t cellOf(const Bounds2D& b)
+    {
+        int32_t gx = coord(centerX(b)), gy = coord(centerY(b));
+        auto [it, added] = lookup.try_emplace(key(gx, gy), (uint32_t)cells.size());
+        if (added) {
+            cells.push_back({ gx, gy, {}, {} });
+            cellMin[0] = std::min(cellMin[0], gx);
+            cellMin[1] = std::min(cellMin[1], gy);
+            cellMax[0] = std::max(cellMax[0], gx);
+            cellMax[1] = std::max(cellMax[1], gy);
+        }
+        return it->second;
+    }
+
+    //中心离开登记的格子不超过slack时留在原地
+    bool staysIn(const Entry& e, const Bounds2D& b) const
+    {
+        float x0 = e.x * cellSize - slack, y0 = e.y * cellSize - slack;
+        float cx = centerX(b), cy = centerY(b);
+        return cx >= x0 && cx < x0 + cellSize + 2.0f * slack && cy >= y0 && cy < y0 + cellSize + 2.0f * slack;
+    }
+
+    const Cell* findCell(int64_t gx, int64_t gy) const
+    {
+        auto it = lookup.find(key(gx, gy));
+        return it == lookup.end() ? nullptr : &cells[it->second];
+    }
+
+    void link(uint32_t id, const Bounds2D& bounds, uint32_t cell)
+    {
+        Entry& e = entries[id];
+        e.cell = cell;
+        e.slot = (uint32_t)cells[cell].ids.size();
+        e.x = cells[cell].x;
+        e.y = cells[cell].y;
+        cells[cell].bounds.push_back(bounds);
+        cells[cell].ids.push_back(id);
+    }
+
+    void unlink(uint32_t id)
+    {
+        Entry& e = entries[id];
+        Cell& cell = cells[e.cell];
+        cell.bounds[e.slot] = cell.bounds.back();
+        cell.ids[e.slot] = cell.ids.back();
+        entries[cell.ids[e.slot]].slot = e.slot;
+        cell.bounds.pop_back();
+        cell.ids.pop_back();
+    }
+
+    //只增不减：删掉最大的实例之后查询会稍微多看几个格子，但结果不变（clear()时重置）
+    void growExtent(const Bounds2D& b)
+    {
+        maxHalf[0] = std::max(maxHalf[0], (b.maxX - b.minX) * 0.5f);
+        maxHalf[1] = std::max(maxHalf[1], (b.maxY - b.minY) * 0.5f);
+    }
+
+    //中心可能落在rect扩大maxHalf之后的范围里的所有实例；中心最多在格子外slack，格子范围再扩slack
+    //中心一定在rect里的格子（内部格子）整格调用 inside(cell)，里面的实例一定和rect相交，不用再测；其余的逐个调用 border(bounds, id)
+    template<typename Inside, typename Border>
+    void forEachCandidate(const Bounds2D& rect, Inside&& inside, Border&& border) const
+    {
+        if (count == 0) return;
+        int64_t x0 = std::max<int64_t>(coord(rect.minX - maxHalf[0] - slack), cellMin[0]);
+        int64_t y0 = std::max<int64_t>(coord(rect.minY - maxHalf[1] - slack), cellMin[1]);
+        int64_t x1 = std::min<int64_t>(coord(rect.maxX + maxHalf[0] + slack), cellMax[0]);
+        int64_t y1 = std::min<int64_t>(coord(rect.maxY + maxHalf[1] + slack), cellMax[1]);
+        if (x0 > x1 || y0 > y1) return;
+        //内部格子：[g*cellSize - slack, (g+1)*cellSize + slack) 在rect里；多留一格，浮点舍入不会把边上的格子算进来
+        int64_t ix0 = (int64_t)coord(rect.minX + slack) + 1, ix1 = (int64_t)coord(rect.maxX - slack) - 1;
+        int64_t iy0 = (int64_t)coord(rect.minY + slack) + 1, iy1 = (int64_t)coord(rect.maxY - slack) - 1;
+        auto visitCell = [&](const Cell& cell) {
+            if (cell.x >= ix0 && cell.x <= ix1 && cell.y >= iy0 && cell.y <= iy1) {
+                inside(cell);
+            } else {
+                for (size_t i = 0; i < cell.ids.size(); ++i) border(cell.bounds[i], cell.ids[i]);
+            }
+        };
+        //范围里的格子比分配过的还多时，直接遍历所有格子更快（范围外的格子当边上的格子测，结果不变）
+        if ((uint64_t)(x1 - x0 + 1) * (uint64_t)(y1 - y0 + 1) > cells.size()) {
+            for (const Cell& cell : cells) visitCell(cell);
+            return;
+        }
+        for (int64_t gy = y0; gy <= y1; ++gy) {
+            for (int64_t gx = x0; gx <= x1; ++gx) {
+                if (const Cell* cell = findCell(gx, gy)) visitCell(*cell);
+            }
+        }
+    }
+
+    float cellSize;
+    float inverseCell;
+    float slack;                                    // 中心可以在格子外多远
+    std::vector<Entry> entries;                     // 按id索引
+    std::vector<Cell> cells;                        // 分配过的格子（空了也保留，实例回来时复用）
+    std::unordered_map<uint64_t, uint32_t> lookup;  // 格子坐标 -> cells下标
+    mutable std::vector<uint64_t> visibleBits;      // gatherVisible 的临时位图
+    uint32_t count = 0;
+    float maxHalf[2] = { 0.0f, 0.0f };
+    int32_t cellMin[2] = { INT32_MAX, INT32_MAX };  // 分配过的格子坐标范围
+    int32_t cellMax[2] = { INT32_MIN, INT32_MIN };
+};
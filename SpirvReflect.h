@@ -0,0 +1,310 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+
+//-----------------SPIR-V反射----------------------
+//直接解析SPIR-V指令流，取出顶点输入（location、名字、类型）、描述符绑定（set、binding、类型、数量）、
+//push constant大小和compute的local size，用来生成C++侧的布局，不再手写一份和shader对应的描述
+//只处理本项目用到的指令，不依赖Vulkan头文件
+
+enum class ShaderStageKind { Vertex, Fragment, Compute, Other };
+
+enum class ScalarKind { Float, Int, Uint };
+
+enum class DescriptorKind {
+    UniformBuffer,
+    StorageBuffer,
+    CombinedImageSampler,
+    SampledImage,
+    StorageImage,
+    Sampler,
+    UniformTexelBuffer,
+    StorageTexelBuffer,
+    InputAttachment
+};
+
+//顶点输入（或其他阶段的输入变量）
+struct ReflectedInput {
+    uint32_t location = 0;
+    std::string name;
+    ScalarKind scalar = ScalarKind::Float;
+    uint32_t width = 32;        // 分量位宽
+    uint32_t components = 1;    // 1~4
+};
+
+struct ReflectedBinding {
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    DescriptorKind kind = DescriptorKind::UniformBuffer;
+    uint32_t count = 1;         // 0表示运行时数组（textures[]）
+    std::string name;
+};
+
+struct ShaderReflection {
+    ShaderStageKind stage = ShaderStageKind::Other;
+    std::string entryPoint;
+    std::vector<ReflectedInput> inputs;         // 按location排序，不含内建变量
+    std::vector<ReflectedBinding> bindings;     // 按(set, binding)排序
+    uint32_t pushConstantSize = 0;              // 0表示没有
+    uint32_t localSize[3] = { 1, 1, 1 };        // compute的local_size
+};
+
+//words：整个SPIR-V模块（32位字）；格式不对时抛异常
+ShaderReflection ReflectSpirv(const uint32_t* words, size_t wordCount)
+{
+    //用到的操作码、装饰、存储类别（SPIR-V规范里的编号）
+    enum : uint32_t {
+        OpName = 5, OpEntryPoint = 15, OpExecutionMode = 16,
+        OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24,
+        OpTypeImage = 25, OpTypeSampler = 26, OpTypeSampledImage = 27, OpTypeArray = 28, OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30, OpTypePointer = 32, OpConstant = 43, OpVariable = 59, OpDecorate = 71, OpMemberDecorate = 72
+    };
+    enum : uint32_t {
+        DecorationBufferBlock = 3, DecorationArrayStride = 6, DecorationMatrixStride = 7,
+        DecorationBuiltIn = 11, DecorationLocation = 30, DecorationBinding = 33, DecorationDescriptorSet = 34, DecorationOffset = 35
+    };
+    enum : uint32_t {
+        StorageUniformConstant = 0, StorageInput = 1, StorageUniform = 2, StoragePushConstant = 9, StorageStorageBuffer = 12
+    };
+    const uint32_t ExecutionModeLocalSize = 17;
+    const uint32_t DimBuffer = 5, DimSubpassData = 6;
+
+    if (wordCount < 5 || words[0] != 0x07230203) throw std::runtime_error("not a SPIR-V module");
+
+    //类型表：每个id一条，只记录用得到的字段
+    struct Type {
+        uint32_t op = 0;
+        uint32_t a = 0, b = 0;                  // 各类型自己的操作数（见下面的解析）
+        std::vector<uint32_t> members;          // OpTypeStruct
+    };
+    struct Decorations {
+        uint32_t location = UINT32_MAX, binding = UINT32_MAX, set = UINT32_MAX;
+        uint32_t arrayStride = 0, matrixStride = 0;
+        bool builtIn = false, bufferBlock = false;
+        std::vector<uint32_t> memberOffsets;
+    };
+    struct Variable {
+        uint32_t id, pointerType, storage;
+    };
+
+    std::unordered_map<uint32_t, Type> types;
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::unordered_map<uint32_t, std::string> names;
+    std::unordered_map<uint32_t, Decorations> decorations;
+    std::vector<Variable> variables;
+    ShaderReflection reflection;
+    uint32_t entryId = UINT32_MAX;
+
+    auto readString = [&](size_t start, size_t end) {
+        std::string s;
+        for (size_t w = start; w < end; ++w) {
+            for (int byte = 0; byte < 4; ++byte) {
+                char c = (char)((words[w] >> (byte * 8)) & 0xFF);
+                if (c == 0) return s;
+                s += c;
+            }
+        }
+        return s;
+    };
+
+    for (size_t pos = 5; pos < wordCount;) {
+        uint32_t op = words[pos] & 0xFFFF;
+        uint32_t count = words[pos] >> 16;
+        if (count == 0 || pos + count > wordCount) throw std::runtime_error("malformed SPIR-V instruction");
+        const uint32_t* in = words + pos;
+
+        switch (op) {
+        case OpName:
+            names[in[1]] = readString(pos + 2, pos + count);
+            break;
+        case OpEntryPoint:
+            //只取第一个入口
+            if (entryId == UINT32_MAX) {
+                entryId = in[2];
+                reflection.stage = in[1] == 0 ? ShaderStageKind::Vertex : in[1] == 4 ? ShaderStageKind::Fragment
+                    : in[1] == 5 ? ShaderStageKind::Compute : ShaderStageKind::Other;
+                reflection.entryPoint = readString(pos + 3, pos + count);
+            }
+            break;
+        case OpExecutionMode:
+            if (in[1] == entryId && in[2] == ExecutionModeLocalSize && count >= 6) {
+                reflection.localSize[0] = in[3];
+                reflection.localSize[1] = in[4];
+                reflection.localSize[2] = in[5];
+            }
+            break;
+        case OpDecorate: {
+            Decorations& d = decorations[in[1]];
+            uint32_t value = count > 3 ? in[3] : 0;
+            switch (in[2]) {
+            case DecorationLocation: d.location = value; break;
+            case DecorationBinding: d.binding = value; break;
+            case DecorationDescriptorSet: d.set = value; break;
+            case DecorationArrayStride: d.arrayStride = value; break;
+            case DecorationBuiltIn: d.builtIn = true; break;
+            case DecorationBufferBlock: d.bufferBlock = true; break;
+            }
+            break;
+        }
+        case OpMemberDecorate: {
+            Decorations& d = decorations[in[1]];
+            uint32_t member = in[2];
+            if (in[3] == DecorationOffset) {
+                if (d.memberOffsets.size() <= member) d.memberOffsets.resize(member + 1, 0);
+                d.memberOffsets[member] = in[4];
+            }
+            else if (in[3] == DecorationMatrixStride) {
+                d.matrixStride = in[4];     // 简化：一个struct里的矩阵成员用同一个列间距
+            }
+            break;
+        }
+        case OpTypeBool:
+        case OpTypeSampler:
+            types[in[1]] = { op };
+            break;
+        case OpTypeInt:             // a=位宽 b=有无符号
+        case OpTypeFloat:           // a=位宽
+        case OpTypeVector:          // a=分量类型 b=分量数
+        case OpTypeMatrix:          // a=列类型 b=列数
+        case OpTypeSampledImage:    // a=image类型
+        case OpTypeArray:           // a=元素类型 b=长度（常量id）
+        case OpTypeRuntimeArray:    // a=元素类型
+            types[in[1]] = { op, in[2], count > 3 ? in[3] : 0 };
+            break;
+        case OpTypeImage:           // a=dim b=sampled(1采样/2存储)
+            types[in[1]] = { op, in[3], in[7] };
+            break;
+        case OpTypeStruct: {
+            Type t{ op };
+            t.members.assign(in + 2, in + count);
+            types[in[1]] = t;
+            break;
+        }
+        case OpTypePointer:         // a=存储类别 b=指向的类型
+            types[in[1]] = { op, in[2], in[3] };
+            break;
+        case OpConstant:
+            constants[in[2]] = in[3];
+            break;
+        case OpVariable:
+            variables.push_back({ in[2], in[1], in[3] });
+            break;
+        }
+        pos += count;
+    }
+
+    auto typeOf = [&](uint32_t id) -> const Type& {
+        auto it = types.find(id);
+        if (it == types.end()) throw std::runtime_error("SPIR-V references unknown type");
+        return it->second;
+    };
+    auto decorationOf = [&](uint32_t id) -> const Decorations& {
+        static const Decorations none;
+        auto it = decorations.find(id);
+        return it == decorations.end() ? none : it->second;
+    };
+
+    //push constant按std430规则的字节大小：最后一个成员的偏移 + 它的大小
+    auto sizeOf = [&](auto&& self, uint32_t id) -> uint32_t {
+        const Type& t = typeOf(id);
+        switch (t.op) {
+        case OpTypeBool: return 4;
+        case OpTypeInt:
+        case OpTypeFloat: return t.a / 8;
+        case OpTypeVector: return self(self, t.a) * t.b;
+        case OpTypeMatrix: return self(self, t.a) * t.b;
+        case OpTypeArray: {
+            uint32_t stride = decorationOf(id).arrayStride ? decorationOf(id).arrayStride : self(self, t.a);
+            return stride * constants[t.b];
+        }
+        case OpTypeStruct: {
+            const Decorations& d = decorationOf(id);
+            uint32_t size = 0;
+            for (size_t m = 0; m < t.members.size(); ++m) {
+                uint32_t offset = m < d.memberOffsets.size() ? d.memberOffsets[m] : size;
+                //矩阵成员的列间距由所在struct的MatrixStride装饰决定
+                const Type& member = typeOf(t.members[m]);
+                uint32_t memberSize = member.op == OpTypeMatrix && d.matrixStride ? d.matrixStride * member.b : self(self, t.members[m]);
+                size = std::max(size, offset + memberSize);
+            }
+            return size;
+        }
+        default: return 0;
+        }
+    };
+
+    for (const Variable& v : variables) {
+        const Type& pointer = typeOf(v.pointerType);
+        uint32_t typeId = pointer.b;
+        const Decorations& d = decorationOf(v.id);
+
+        if (v.storage == StorageInput) {
+            if (d.builtIn || d.location == UINT32_MAX) continue;
+            const Type& t = typeOf(typeId);
+            ReflectedInput input;
+            input.location = d.location;
+            input.name = names.count(v.id) ? names[v.id] : std::string();
+            uint32_t scalarId = typeId;
+            if (t.op == OpTypeVector) {
+                input.components = t.b;
+                scalarId = t.a;
+            }
+            const Type& scalar = typeOf(scalarId);
+            if (scalar.op != OpTypeFloat && scalar.op != OpTypeInt) continue;   // 结构体/矩阵输入本项目用不到
+            input.width = scalar.a;
+            input.scalar = scalar.op == OpTypeFloat ? ScalarKind::Float : scalar.b ? ScalarKind::Int : ScalarKind::Uint;
+            reflection.inputs.push_back(input);
+        }
+        else if (v.storage == StoragePushConstant) {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, sizeOf(sizeOf, typeId));
+        }
+        else if (v.storage == StorageUniformConstant || v.storage == StorageUniform || v.storage == StorageStorageBuffer) {
+            if (d.binding == UINT32_MAX) continue;
+            ReflectedBinding binding;
+            binding.set = d.set == UINT32_MAX ? 0 : d.set;
+            binding.binding = d.binding;
+            binding.name = names.count(v.id) ? names[v.id] : std::string();
+
+            //数组：取出元素类型和数量
+            const Type* t = &typeOf(typeId);
+            uint32_t elementId = typeId;
+            if (t->op == OpTypeArray) {
+                binding.count = constants[t->b];
+                elementId = t->a;
+            }
+            else if (t->op == OpTypeRuntimeArray) {
+                binding.count = 0;
+                elementId = t->a;
+            }
+            t = &typeOf(elementId);
+
+            if (v.storage == StorageStorageBuffer) binding.kind = DescriptorKind::StorageBuffer;
+            else if (v.storage == StorageUniform) {
+                binding.kind = decorationOf(elementId).bufferBlock ? DescriptorKind::StorageBuffer : DescriptorKind::UniformBuffer;
+            }
+            else if (t->op == OpTypeSampledImage) {
+                binding.kind = typeOf(t->a).a == DimBuffer ? DescriptorKind::UniformTexelBuffer : DescriptorKind::CombinedImageSampler;
+            }
+            else if (t->op == OpTypeSampler) binding.kind = DescriptorKind::Sampler;
+            else if (t->op == OpTypeImage) {
+                if (t->a == DimSubpassData) binding.kind = DescriptorKind::InputAttachment;
+                else if (t->a == DimBuffer) binding.kind = t->b == 2 ? DescriptorKind::StorageTexelBuffer : DescriptorKind::UniformTexelBuffer;
+                else binding.kind = t->b == 2 ? DescriptorKind::StorageImage : DescriptorKind::SampledImage;
+            }
+            else continue;
+            reflection.bindings.push_back(binding);
+        }
+    }
+
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(),
+        [](const ReflectedInput& l, const ReflectedInput& r) { return l.location < r.location; });
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& l, const ReflectedBinding& r) {
+        return l.set != r.set ? l.set < r.set : l.binding < r.binding;
+    });
+    return reflection;
+}
@@ -0,0 +1,264 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+//-----------------精灵批处理----------------------
+//每个精灵先记进一个紧凑的命令流，并附带一个64位排序键；end()时基数排序，
+//相邻且pipeline相同的精灵合并成一次实例化 drawIndexed（贴图走bindless数组，换贴图不打断合批）
+//排序键里depth排在pipeline和贴图区域之后：同一layer里先按pipeline、再按贴图区域分组，depth只决定同一组里的先后，
+//pipeline或贴图不同的精灵之间没有前后保证（要靠depth叠放的放进不同layer）；换来的是合批更长、同一张贴图的实例连续
+
+// 实例数据：每个精灵一份，直接写进实例环形缓冲（布局必须和 test.vert 的输入、cull.comp 的 Instance 一致）
+// 【修改】压缩到16字节：位置和缩放用半精度，旋转量化成16位，贴图和UV范围换成贴图区域表的下标
+struct InstanceData {
+    uint16_t offset[2];     // 位置（half，eR16G16Sfloat）
+    uint16_t scale[2];      // 缩放（half），乘在单位正方形的顶点上
+    uint16_t rotation;      // 旋转，[0, 2π) 映射到 [0, 65535]（eR16Unorm）
+    uint16_t region;        // 贴图区域下标（见 BindlessTextures 的区域表）
+    uint32_t color;         // RGBA8，低字节是R（对应 eR8G8B8A8Unorm）
+};
+static_assert(sizeof(InstanceData) == 16, "InstanceData must match the std430 Instance in cull.comp");
+
+//材质：决定用哪条pipeline，变化会打断合批
+struct Material {
+    uint8_t pipeline = 0;
+};
+
+//贴图引用：贴图区域表的下标，区域 = bindless数组下标 + UV范围（图集里的一块）
+struct TextureRef {
+    uint32_t region = 0;            // 0号是整张1x1白图
+};
+
+struct SpriteTransform {
+    float x = 0.0f, y = 0.0f;
+    float scaleX = 1.0f, scaleY = 1.0f;
+    float rotation = 0.0f;
+};
+
+//合并后的一次绘制
+struct SpriteDrawCmd {
+    Material material;
+    uint32_t firstInstance;     // 相对本帧实例段起点
+    uint32_t instanceCount;
+};
+
+struct SpriteBatchStats {
+    uint32_t sprites = 0;
+    uint32_t drawCalls = 0;
+    uint32_t pipelineChanges = 0;
+    uint32_t textureChanges = 0;    // 合批内相邻精灵贴图区域不同的次数（bindless下不需要重新绑定）
+    double sortMs = 0.0;
+};
+
+//float转半精度（就近舍入到偶数，超出范围变成无穷大）；SpriteSimulation 的SIMD版本和它逐位一致
+uint16_t PackHalf(float value)
+{
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+    uint32_t h;
+    if (f >= (127u + 16u) << 23) {
+        h = f > 0x7F800000u ? 0x7E00u : 0x7C00u;    // NaN / 无穷大
+    }
+    else if (f < (127u - 14u) << 23) {
+        //结果是非规格化数：加一个魔数让硬件按当前舍入模式把尾数移到位
+        const uint32_t magicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        float magic, shifted;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        memcpy(&shifted, &f, sizeof(shifted));
+        shifted += magic;
+        memcpy(&h, &shifted, sizeof(h));
+        h -= magicBits;
+    }
+    else {
+        uint32_t mantissaOdd = (f >> 13) & 1;
+        f += (uint32_t)(15 - 127) * (1u << 23) + 0xFFFu + mantissaOdd;
+        h = f >> 13;
+    }
+    return (uint16_t)(h | (sign >> 16));
+}
+
+//半精度转回float（调试和测试用）
+float UnpackHalf(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FFu;
+    uint32_t f;
+    if (exponent == 0x1F) f = sign | 0x7F800000u | (mantissa << 13);
+    else if (exponent != 0) f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else {
+        float value = mantissa * (1.0f / 16777216.0f);  // 2^-24
+        memcpy(&f, &value, sizeof(f));
+        f |= sign;
+    }
+    float out;
+    memcpy(&out, &f, sizeof(out));
+    return out;
+}
+
+//旋转量化成16位：先折到[0, 2π)，再映射到[0, 65535]
+uint16_t PackAngle(float radians)
+{
+    const float twoPi = 6.28318531f;
+    float r = radians - twoPi * std::floor(radians * (1.0f / twoPi));
+    return (uint16_t)std::min(r * (65535.0f / twoPi) + 0.5f, 65535.0f);
+}
+
+//RGBA打包成 R8G8B8A8
+constexpr uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255)
+{
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+//64位键按8位一位做LSD基数排序；所有元素在某一位上都相同时跳过这一趟
+struct SortItem {
+    uint64_t key;
+    uint32_t index;
+};
+
+void RadixSort64(std::vector<SortItem>& items, std::vector<SortItem>& scratch)
+{
+    const size_t n = items.size();
+    if (n < 2) return;
+    scratch.resize(n);
+
+    //一次遍历把8位数字的直方图全算出来
+    std::vector<std::array<uint32_t, 256>> histograms(8);
+    for (auto& h : histograms) h.fill(0);
+    for (const auto& item : items) {
+        for (int d = 0; d < 8; ++d) histograms[d][(item.key >> (d * 8)) & 0xFF]++;
+    }
+
+    SortItem* src = items.data();
+    SortItem* dst = scratch.data();
+    for (int d = 0; d < 8; ++d) {
+        auto& h = histograms[d];
+        if (h[(src[0].key >> (d * 8)) & 0xFF] == n) continue;   // 这一位全都一样
+
+        uint32_t sum = 0;
+        for (auto& c : h) {
+            uint32_t count = c;
+            c = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < n; ++i) dst[h[(src[i].key >> (d * 8)) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != items.data()) memcpy(items.data(), src, n * sizeof(SortItem));
+}
+
+class SpriteBatch {
+public:
+    //排序键：layer(8) | pipeline(8) | 贴图区域(16) | depth(16) | 保留(16)
+    //贴图已经不影响合批，放进键里只是让用同一张图的精灵挨在一起，采样时缓存更友好
+    //LSD基数排序是稳定的，键完全相同的精灵保持提交时的前后关系
+    static uint64_t MakeKey(uint8_t layer, const Material& material, uint32_t region, float depth)
+    {
+        //depth限制在[0,1]，量化到16位，越大越靠后画
+        float d = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+        uint64_t depthBits = (uint64_t)(d * 65535.0f);
+        return ((uint64_t)layer << 56) | ((uint64_t)material.pipeline << 48) | ((uint64_t)(region & 0xFFFF) << 32)
+            | (depthBits << 16);
+    }
+
+    void begin()
+    {
+        instances.clear();
+        materials.clear();
+        items.clear();
+        drawList.clear();
+        lastStats = {};
+    }
+
+    //纯色矩形：以(x,y)为中心，宽高按单位正方形缩放
+    void drawQuad(float x, float y, float scaleX, float scaleY, uint32_t color, uint8_t layer = 0, float depth = 0.0f)
+    {
+        drawSprite({ x, y, scaleX, scaleY, 0.0f }, color, TextureRef{}, Material{}, layer, depth);
+    }
+
+    void drawSprite(const SpriteTransform& transform, uint32_t color, const TextureRef& texture, const Material& material = {},
+        uint8_t layer = 0, float depth = 0.0f)
+    {
+        uint32_t index = (uint32_t)instances.size();
+        InstanceData inst;
+        inst.offset[0] = PackHalf(transform.x);
+        inst.offset[1] = PackHalf(transform.y);
+        inst.scale[0] = PackHalf(transform.scaleX);
+        inst.scale[1] = PackHalf(transform.scaleY);
+        inst.rotation = PackAngle(transform.rotation);
+        inst.region = (uint16_t)texture.region;
+        inst.color = color;
+        instances.push_back(inst);
+        materials.push_back(material);
+        items.push_back({ MakeKey(layer, material, texture.region, depth), index });
+    }
+
+    uint32_t size() const { return (uint32_t)instances.size(); }
+
+    //一次绘制最多合并多少个实例（默认不限；设成1相当于每个精灵单独一次draw，用来压测录制）
+    void setMaxBatchSize(uint32_t count) { maxBatchSize = std::max(count, 1u); }
+
+    //排序、合批，并把实例按排好的顺序写进dst（一般是实例环形缓冲里本帧的那一段）
+    void end(InstanceData* dst)
+    {
+        auto start = std::chrono::steady_clock::now();
+        RadixSort64(items, scratch);
+        lastStats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        drawList.clear();
+        for (uint32_t i = 0; i < items.size(); ++i) {
+            uint32_t src = items[i].index;
+            dst[i] = instances[src];
+
+            const Material& m = materials[src];
+            //dst是写合并的映射内存，不从里面读回
+            if (i > 0 && instances[items[i - 1].index].region != instances[src].region) lastStats.textureChanges++;
+            if (!drawList.empty()) {
+                SpriteDrawCmd& last = drawList.back();
+                if (last.material.pipeline == m.pipeline && last.instanceCount < maxBatchSize) {
+                    last.instanceCount++;
+                    continue;
+                }
+                if (last.material.pipeline != m.pipeline) lastStats.pipelineChanges++;
+            }
+            drawList.push_back({ m, i, 1 });
+        }
+        lastStats.sprites = (uint32_t)items.size();
+        lastStats.drawCalls = (uint32_t)drawList.size();
+    }
+
+    //end()之后追加一段调用者自己写好的实例（比如 SpriteSimulation 直接写进映射内存的），紧接在排好序的实例后面，
+    //不参与排序，只按 maxBatchSize 切成绘制命令。返回这一段在本帧实例里的起点
+    uint32_t appendRun(const Material& material, uint32_t count)
+    {
+        uint32_t first = lastStats.sprites;
+        for (uint32_t done = 0; done < count;) {
+            uint32_t n = std::min(count - done, maxBatchSize);
+            if (!drawList.empty() && drawList.back().material.pipeline != material.pipeline) lastStats.pipelineChanges++;
+            drawList.push_back({ material, first + done, n });
+            done += n;
+        }
+        lastStats.sprites += count;
+        lastStats.drawCalls = (uint32_t)drawList.size();
+        return first;
+    }
+
+    const std::vector<SpriteDrawCmd>& draws() const { return drawList; }
+    const SpriteBatchStats& stats() const { return lastStats; }
+
+private:
+    std::vector<InstanceData> instances;    // 按提交顺序存放的命令流
+    std::vector<Material> materials;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    std::vector<SpriteDrawCmd> drawList;
+    SpriteBatchStats lastStats;
+    uint32_t maxBatchSize = UINT32_MAX;
+};
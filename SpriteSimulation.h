@@ -0,0 +1,433 @@
+#pragma once
+#include "SpriteBatch.h"
+#include "JobSystem.h"
+#include "SpatialGrid.h"
+#include <cmath>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMPLE2D_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SIMPLE2D_AVX2 1
+#include <immintrin.h>
+#endif
+
+//-----------------CPU精灵模拟（SoA + SIMD）----------------------
+//大量运动的精灵（粒子）：状态按字段分开存成数组（SoA），每帧积分、动画和打包在同一趟循环里完成，
+//SIMD一次处理4/8个精灵，结果直接打包成16字节的InstanceData（半精度位置/缩放、16位旋转）写进实例环形缓冲的映射内存，中间不再拷贝
+//（updateVisible 例外：全部精灵先打包进CPU侧的暂存数组，再按下标把可见的那些拷进映射内存）
+//精灵按块分给 JobSystem 的线程，块与块之间不共享任何数据
+//SSE2在x64上总是可用；AVX2需要编译时打开（/arch:AVX2 或 -mavx2，CMake里是 SIMPLE2D_ENABLE_AVX2）
+
+//64字节对齐（一条缓存线），SIMD可以用对齐读写
+template<typename T, size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template<typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template<typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Align)); }
+    bool operator==(const AlignedAllocator&) const { return true; }
+    bool operator!=(const AlignedAllocator&) const { return false; }
+};
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+//用哪套内核（benchmark里用来对比；默认用编译进来的最快的一套）
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+const char* SimdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::SSE2: return "sse2";
+    case SimdLevel::AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+constexpr SimdLevel BestSimdLevel()
+{
+#if defined(SIMPLE2D_AVX2)
+    return SimdLevel::AVX2;
+#elif defined(SIMPLE2D_SSE2)
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+//每个精灵的状态，一个字段一个数组
+//动画：位置按速度积分，碰到[-bounds, bounds]的边界反弹；自转；缩放在0.75~1.25倍之间按三角波来回变化
+struct SpriteSoA {
+    AlignedVector<float> posX, posY;
+    AlignedVector<float> velX, velY;
+    AlignedVector<float> rotation, spin;        // 弧度，弧度/秒
+    AlignedVector<float> baseScale;
+    AlignedVector<float> phase, pulseRate;      // 缩放动画的相位[0,1)，每秒走多少
+    AlignedVector<uint32_t> color;
+    AlignedVector<uint32_t> region;             // 贴图区域下标（低16位有效）
+};
+
+//新精灵的初始状态
+struct SpriteSpawn {
+    float x = 0.0f, y = 0.0f;
+    float velX = 0.0f, velY = 0.0f;
+    float rotation = 0.0f, spin = 0.0f;
+    float scale = 1.0f;
+    float phase = 0.0f, pulseRate = 0.0f;
+    uint32_t color = 0xFFFFFFFF;
+    TextureRef texture;
+};
+
+class SpriteSimulation {
+public:
+    //每个任务至少处理这么多精灵（必须是8的倍数，保证每块的起点对齐）
+    static constexpr uint32_t Grain = 16384;
+
+    explicit SpriteSimulation(float bounds = 1.0f) : bounds(bounds) {}
+
+    void reserve(uint32_t count)
+    {
+        forEachArray([count](auto& a) { a.reserve(count); });
+    }
+
+    void add(const SpriteSpawn& s)
+    {
+        sprites.posX.push_back(s.x);
+        sprites.posY.push_back(s.y);
+        sprites.velX.push_back(s.velX);
+        sprites.velY.push_back(s.velY);
+        sprites.rotation.push_back(s.rotation);
+        sprites.spin.push_back(s.spin);
+        sprites.baseScale.push_back(s.scale);
+        sprites.phase.push_back(s.phase - std::floor(s.phase));
+        sprites.pulseRate.push_back(s.pulseRate);
+        sprites.color.push_back(s.color);
+        sprites.region.push_back(s.texture.region & 0xFFFF);
+    }
+
+    void clear()
+    {
+        forEachArray([](auto& a) { a.clear(); });
+    }
+
+    uint32_t size() const { return (uint32_t)sprites.posX.size(); }
+    const SpriteSoA& state() const { return sprites; }
+    float worldBounds() const { return bounds; }
+
+    void setSimdLevel(SimdLevel level) { simd = std::min(level, BestSimdLevel()); }
+    SimdLevel simdLevel() const { return simd; }
+
+    //第i个精灵的保守包围盒：单位正方形半边长0.1，缩放按脉动的最大值，再按任意旋转取外接正方形
+    Bounds2D spriteBounds(uint32_t i) const
+    {
+        float half = 0.1f * 1.25f * 1.41421356f * sprites.baseScale[i];
+        return Bounds2D::FromCenter(sprites.posX[i], sprites.posY[i], half, half);
+    }
+
+    //把所有精灵的包围盒同步进空间索引（id就是精灵下标）；中心没换格子的精灵只改包围盒
+    void updateGrid(SpatialGrid& grid) const
+    {
+        for (uint32_t i = 0; i < size(); ++i) grid.insert(i, spriteBounds(i));
+    }
+
+    //推进dt秒，并把所有精灵按下标顺序写进dst[0, size())
+    //dt要小于一个缩放周期、每帧位移不超过边界宽度（反弹只处理一次）
+    //jobs为空时在调用线程上跑完
+    void update(float dt, InstanceData* dst, JobSystem* jobs = nullptr)
+    {
+        uint32_t count = size();
+        if (jobs && count > Grain) {
+            jobs->parallelFor(count, Grain, [&](uint32_t begin, uint32_t end, uint32_t) { updateRange(begin, end, dt, dst); });
+        }
+        else {
+            updateRange(0, count, dt, dst);
+        }
+    }
+
+    //推进dt秒，同一趟里把包围盒同步进grid（id就是精灵下标），然后只把包围盒和view相交的精灵按下标顺序写进dst，返回写了几个
+    //内核先写进CPU侧的暂存数组；中心没换格子的精灵在各自的任务里就地更新网格，换了格子的最后在调用线程上重新登记
+    //grid里只能有这个模拟的精灵（第一次调用时全部登记一遍）
+    uint32_t updateVisible(float dt, InstanceData* dst, SpatialGrid& grid, const Bounds2D& view, JobSystem* jobs = nullptr)
+    {
+        uint32_t count = size();
+        packed.resize(count);
+        moved.resize(jobs ? jobs->slotCount() : 1);
+        for (auto& m : moved) m.clear();
+        auto step = [&](uint32_t begin, uint32_t end, uint32_t slot) {
+            updateRange(begin, end, dt, packed.data());
+            for (uint32_t i = begin; i < end; ++i) {
+                if (!grid.updateInPlace(i, spriteBounds(i))) moved[slot].push_back(i);
+            }
+        };
+        if (jobs && count > Grain) jobs->parallelFor(count, Grain, step);
+        else step(0, count, 0);
+        for (auto& m : moved) {
+            for (uint32_t i : m) grid.insert(i, spriteBounds(i));
+        }
+        //可见的按下标顺序连续写进映射内存
+        grid.gatherVisible(view, visible);
+        for (size_t k = 0; k < visible.size(); ++k) dst[k] = packed[visible[k]];
+        return (uint32_t)visible.size();
+    }
+
+    //只更新[begin, end)，begin必须是8的倍数
+    void updateRange(uint32_t begin, uint32_t end, float dt, InstanceData* dst)
+    {
+        switch (simd) {
+#if defined(SIMPLE2D_AVX2)
+        case SimdLevel::AVX2: begin = updateAvx2(begin, end, dt, dst); break;
+#endif
+#if defined(SIMPLE2D_SSE2)
+        case SimdLevel::SSE2: begin = updateSse2(begin, end, dt, dst); break;
+#endif
+        default: break;
+        }
+        updateScalar(begin, end, dt, dst);
+    }
+
+private:
+    template<typename Fn>
+    void forEachArray(Fn fn)
+    {
+        fn(sprites.posX); fn(sprites.posY); fn(sprites.velX); fn(sprites.velY);
+        fn(sprites.rotation); fn(sprites.spin); fn(sprites.baseScale); fn(sprites.phase); fn(sprites.pulseRate);
+        fn(sprites.color); fn(sprites.region);
+    }
+
+    //标量版本：SIMD的尾巴，以及没有SSE2的平台。运算顺序和SIMD版本一致，结果逐位相同
+    void updateScalar(uint32_t begin, uint32_t end, float dt, InstanceData* dst)
+    {
+        const float pi = 3.14159265f, twoPi = 6.28318531f;
+        SpriteSoA& s = sprites;
+        for (uint32_t i = begin; i < end; ++i) {
+            float x = s.posX[i] + s.velX[i] * dt;
+            float y = s.posY[i] + s.velY[i] * dt;
+            if (x > bounds) { x = 2.0f * bounds - x; s.velX[i] = -s.velX[i]; }
+            else if (x < -bounds) { x = -2.0f * bounds - x; s.velX[i] = -s.velX[i]; }
+            if (y > bounds) { y = 2.0f * bounds - y; s.velY[i] = -s.velY[i]; }
+            else if (y < -bounds) { y = -2.0f * bounds - y; s.velY[i] = -s.velY[i]; }
+            float r = s.rotation[i] + s.spin[i] * dt;
+            if (r > pi) r -= twoPi;
+            else if (r < -pi) r += twoPi;
+            float p = s.phase[i] + s.pulseRate[i] * dt;
+            if (p >= 1.0f) p -= 1.0f;
+            s.posX[i] = x;
+            s.posY[i] = y;
+            s.rotation[i] = r;
+            s.phase[i] = p;
+            float scale = s.baseScale[i] * (0.75f + 0.5f * std::fabs(2.0f * p - 1.0f));
+
+            InstanceData& d = dst[i];
+            d.offset[0] = PackHalf(x);
+            d.offset[1] = PackHalf(y);
+            d.scale[0] = d.scale[1] = PackHalf(scale);
+            d.rotation = PackAngle(r);
+            d.region = (uint16_t)s.region[i];
+            d.color = s.color[i];
+        }
+    }
+
+#if defined(SIMPLE2D_SSE2)
+    //4个float转半精度（和 PackHalf 同样的算法），结果在每个32位的低16位
+    static __m128i toHalf(__m128 f)
+    {
+        const __m128i f16max = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+        __m128 justSign = _mm_and_ps(f, _mm_set1_ps(-0.0f));
+        __m128 absF = _mm_xor_ps(f, justSign);
+        __m128i absBits = _mm_castps_si128(absF);
+        __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absF, absF));
+        __m128i isRegular = _mm_cmpgt_epi32(f16max, absBits);
+        __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+        __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+        __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);     // 尾数最低位为1时是-1
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+        __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+        __m128i bits = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+        return _mm_and_si128(_mm_or_si128(bits, _mm_srli_epi32(_mm_castps_si128(justSign), 16)), _mm_set1_epi32(0xFFFF));
+    }
+
+    //打包4个精灵：每个InstanceData正好是4个32位（位置 | 缩放 | 旋转+区域 | 颜色），4x4转置后按顺序写出去，
+    //4个精灵64字节正好一条缓存线，映射内存里整条写满，写合并不会断。rotation要在[-π, π]里
+    static void pack4(InstanceData* dst, __m128 x, __m128 y, __m128 scale, __m128 rotation, __m128i color, __m128i region)
+    {
+        const __m128 twoPi = _mm_set1_ps(6.28318531f);
+        __m128i position = _mm_or_si128(toHalf(x), _mm_slli_epi32(toHalf(y), 16));
+        __m128i scaleHalf = toHalf(scale);
+        __m128i scales = _mm_or_si128(scaleHalf, _mm_slli_epi32(scaleHalf, 16));
+        //和 PackAngle 一样：先折到[0, 2π)再量化
+        __m128 wrapped = _mm_add_ps(rotation, _mm_and_ps(_mm_cmplt_ps(rotation, _mm_setzero_ps()), twoPi));
+        __m128 angle = _mm_min_ps(_mm_add_ps(_mm_mul_ps(wrapped, _mm_set1_ps(65535.0f / 6.28318531f)), _mm_set1_ps(0.5f)), _mm_set1_ps(65535.0f));
+        __m128i rotationRegion = _mm_or_si128(_mm_cvttps_epi32(angle), _mm_slli_epi32(region, 16));
+
+        __m128i t0 = _mm_unpacklo_epi32(position, scales), t1 = _mm_unpackhi_epi32(position, scales);
+        __m128i t2 = _mm_unpacklo_epi32(rotationRegion, color), t3 = _mm_unpackhi_epi32(rotationRegion, color);
+        __m128i* out = reinterpret_cast<__m128i*>(dst);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi64(t0, t2));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi64(t0, t2));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi64(t1, t3));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi64(t1, t3));
+    }
+
+    //a或b里选：mask的位为1取b
+    static __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+    }
+
+    //返回处理到哪里，剩下不满4个的交给标量版本
+    uint32_t updateSse2(uint32_t begin, uint32_t end, float dt, InstanceData* dst)
+    {
+        SpriteSoA& s = sprites;
+        const __m128 vdt = _mm_set1_ps(dt);
+        const __m128 hi = _mm_set1_ps(bounds), lo = _mm_set1_ps(-bounds);
+        const __m128 hi2 = _mm_set1_ps(2.0f * bounds), lo2 = _mm_set1_ps(-2.0f * bounds);
+        const __m128 pi = _mm_set1_ps(3.14159265f), negPi = _mm_set1_ps(-3.14159265f), twoPi = _mm_set1_ps(6.28318531f);
+        const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), half = _mm_set1_ps(0.5f), base = _mm_set1_ps(0.75f);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4) {
+            __m128 vx = _mm_load_ps(&s.velX[i]), vy = _mm_load_ps(&s.velY[i]);
+            __m128 x = _mm_add_ps(_mm_load_ps(&s.posX[i]), _mm_mul_ps(vx, vdt));
+            __m128 y = _mm_add_ps(_mm_load_ps(&s.posY[i]), _mm_mul_ps(vy, vdt));
+            //反弹：越界的分量镜像回来，速度取反
+            __m128 overX = _mm_cmpgt_ps(x, hi), underX = _mm_cmplt_ps(x, lo);
+            x = select(overX, x, _mm_sub_ps(hi2, x));
+            x = select(underX, x, _mm_sub_ps(lo2, x));
+            vx = _mm_xor_ps(vx, _mm_and_ps(_mm_or_ps(overX, underX), sign));
+            __m128 overY = _mm_cmpgt_ps(y, hi), underY = _mm_cmplt_ps(y, lo);
+            y = select(overY, y, _mm_sub_ps(hi2, y));
+            y = select(underY, y, _mm_sub_ps(lo2, y));
+            vy = _mm_xor_ps(vy, _mm_and_ps(_mm_or_ps(overY, underY), sign));
+
+            __m128 r = _mm_add_ps(_mm_load_ps(&s.rotation[i]), _mm_mul_ps(_mm_load_ps(&s.spin[i]), vdt));
+            r = _mm_sub_ps(r, _mm_and_ps(_mm_cmpgt_ps(r, pi), twoPi));
+            r = _mm_add_ps(r, _mm_and_ps(_mm_cmplt_ps(r, negPi), twoPi));
+            __m128 p = _mm_add_ps(_mm_load_ps(&s.phase[i]), _mm_mul_ps(_mm_load_ps(&s.pulseRate[i]), vdt));
+            p = _mm_sub_ps(p, _mm_and_ps(_mm_cmpge_ps(p, one), one));
+
+            _mm_store_ps(&s.posX[i], x);
+            _mm_store_ps(&s.posY[i], y);
+            _mm_store_ps(&s.velX[i], vx);
+            _mm_store_ps(&s.velY[i], vy);
+            _mm_store_ps(&s.rotation[i], r);
+            _mm_store_ps(&s.phase[i], p);
+            __m128 tri = _mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(two, p), one));
+            __m128 scale = _mm_mul_ps(_mm_load_ps(&s.baseScale[i]), _mm_add_ps(base, _mm_mul_ps(half, tri)));
+
+            pack4(dst + i, x, y, scale, r,
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&s.color[i])),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(&s.region[i])));
+        }
+        return i;
+    }
+#endif
+
+#if defined(SIMPLE2D_AVX2)
+    static __m256 select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(a, b, mask); }
+
+    //和SSE2版本同样的运算，一次8个；打包时拆成两组4个（VEX编码的128位指令，没有切换开销）
+    uint32_t updateAvx2(uint32_t begin, uint32_t end, float dt, InstanceData* dst)
+    {
+        SpriteSoA& s = sprites;
+        const __m256 vdt = _mm256_set1_ps(dt);
+        const __m256 hi = _mm256_set1_ps(bounds), lo = _mm256_set1_ps(-bounds);
+        const __m256 hi2 = _mm256_set1_ps(2.0f * bounds), lo2 = _mm256_set1_ps(-2.0f * bounds);
+        const __m256 pi = _mm256_set1_ps(3.14159265f), negPi = _mm256_set1_ps(-3.14159265f), twoPi = _mm256_set1_ps(6.28318531f);
+        const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), half = _mm256_set1_ps(0.5f), base = _mm256_set1_ps(0.75f);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            __m256 vx = _mm256_load_ps(&s.velX[i]), vy = _mm256_load_ps(&s.velY[i]);
+            __m256 x = _mm256_add_ps(_mm256_load_ps(&s.posX[i]), _mm256_mul_ps(vx, vdt));
+            __m256 y = _mm256_add_ps(_mm256_load_ps(&s.posY[i]), _mm256_mul_ps(vy, vdt));
+            __m256 overX = _mm256_cmp_ps(x, hi, _CMP_GT_OQ), underX = _mm256_cmp_ps(x, lo, _CMP_LT_OQ);
+            x = select(overX, x, _mm256_sub_ps(hi2, x));
+            x = select(underX, x, _mm256_sub_ps(lo2, x));
+            vx = _mm256_xor_ps(vx, _mm256_and_ps(_mm256_or_ps(overX, underX), sign));
+            __m256 overY = _mm256_cmp_ps(y, hi, _CMP_GT_OQ), underY = _mm256_cmp_ps(y, lo, _CMP_LT_OQ);
+            y = select(overY, y, _mm256_sub_ps(hi2, y));
+            y = select(underY, y, _mm256_sub_ps(lo2, y));
+            vy = _mm256_xor_ps(vy, _mm256_and_ps(_mm256_or_ps(overY, underY), sign));
+
+            __m256 r = _mm256_add_ps(_mm256_load_ps(&s.rotation[i]), _mm256_mul_ps(_mm256_load_ps(&s.spin[i]), vdt));
+            r = _mm256_sub_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, pi, _CMP_GT_OQ), twoPi));
+            r = _mm256_add_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, negPi, _CMP_LT_OQ), twoPi));
+            __m256 p = _mm256_add_ps(_mm256_load_ps(&s.phase[i]), _mm256_mul_ps(_mm256_load_ps(&s.pulseRate[i]), vdt));
+            p = _mm256_sub_ps(p, _mm256_and_ps(_mm256_cmp_ps(p, one, _CMP_GE_OQ), one));
+
+            _mm256_store_ps(&s.posX[i], x);
+            _mm256_store_ps(&s.posY[i], y);
+            _mm256_store_ps(&s.velX[i], vx);
+            _mm256_store_ps(&s.velY[i], vy);
+            _mm256_store_ps(&s.rotation[i], r);
+            _mm256_store_ps(&s.phase[i], p);
+            __m256 tri = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_mul_ps(two, p), one));
+            __m256 scale = _mm256_mul_ps(_mm256_load_ps(&s.baseScale[i]), _mm256_add_ps(base, _mm256_mul_ps(half, tri)));
+
+            __m128i color0 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s.color[i]));
+            __m128i color1 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s.color[i + 4]));
+            __m128i region0 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s.region[i]));
+            __m128i region1 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s.region[i + 4]));
+            pack4(dst + i, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(scale),
+                _mm256_castps256_ps128(r), color0, region0);
+            pack4(dst + i + 4, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(scale, 1),
+                _mm256_extractf128_ps(r, 1), color1, region1);
+        }
+        return i;
+    }
+#endif
+
+    SpriteSoA sprites;
+    AlignedVector<InstanceData> packed;             // updateVisible 的暂存（全部精灵）
+    std::vector<std::vector<uint32_t>> moved;       // updateVisible 里每个线程槽位换了格子的精灵
+    std::vector<uint32_t> visible;
+    float bounds;
+    SimdLevel simd = BestSimdLevel();
+};
+
+//SpawnRandomSprites 的精灵最大约0.053宽，空间索引的格子取一个精灵大小
+const float SPRITE_GRID_CELL = 0.05f;
+
+//随机撒一批精灵（确定性的，同样的参数每次结果一样）：场景和benchmark共用
+void SpawnRandomSprites(SpriteSimulation& sim, uint32_t count, const std::vector<TextureRef>& textures, uint32_t seed = 1)
+{
+    uint32_t state = seed ? seed : 1;
+    auto next = [&state] {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);   // [0,1)
+    };
+    float b = sim.worldBounds();
+    sim.reserve(sim.size() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        SpriteSpawn s;
+        s.x = (next() * 2.0f - 1.0f) * b;
+        s.y = (next() * 2.0f - 1.0f) * b;
+        float angle = next() * 6.28318531f, speed = (0.1f + next() * 0.4f) * b;
+        s.velX = std::cos(angle) * speed;
+        s.velY = std::sin(angle) * speed;
+        s.rotation = (next() * 2.0f - 1.0f) * 3.14159265f;
+        s.spin = (next() * 2.0f - 1.0f) * 3.0f;
+        s.scale = 0.05f + next() * 0.1f;
+        s.phase = next();
+        s.pulseRate = 0.2f + next();
+        s.color = PackColor((uint8_t)(next() * 255.0f), (uint8_t)(next() * 255.0f), (uint8_t)(next() * 255.0f));
+        if (!textures.empty()) s.texture = textures[i % textures.size()];
+        sim.add(s);
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <algorithm>
+
+//-----------------贴图图集----------------------
+//成千上万张小图各占一张VkImage会把描述符和合批全打散，这里用 skyline 算法把它们装进少数几张大图（页），
+//每张小图只记住自己在哪一页、UV范围是多少；每页再在CPU上生成mip链
+
+//一张待装箱的RGBA8图片
+struct AtlasImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;    // width * height * 4
+};
+
+//小图在图集里的位置
+struct AtlasRegion {
+    uint32_t page = 0;              // 第几页
+    float uv[4] = { 0, 0, 1, 1 };   // u0, v0, u1, v1
+};
+
+//一页：mips[0]是原图，之后每级宽高减半
+struct AtlasPage {
+    uint32_t size = 0;
+    std::vector<std::vector<uint8_t>> mips;
+};
+
+//Skyline装箱：维护一条"天际线"（每段的x、宽度、高度），新矩形放在能让它落得最低的位置
+class SkylinePacker {
+public:
+    explicit SkylinePacker(uint32_t size) : size(size) { skyline.push_back({ 0, 0, size }); }
+
+    //放得下返回左上角坐标
+    std::optional<std::pair<uint32_t, uint32_t>> pack(uint32_t w, uint32_t h)
+    {
+        size_t bestIndex = SIZE_MAX;
+        uint32_t bestY = UINT32_MAX, bestWidth = UINT32_MAX;
+        for (size_t i = 0; i < skyline.size(); ++i) {
+            uint32_t y;
+            if (!fits(i, w, h, y)) continue;
+            //最低优先，一样低时选更窄的段（减少浪费）
+            if (y < bestY || (y == bestY && skyline[i].width < bestWidth)) {
+                bestIndex = i;
+                bestY = y;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestIndex == SIZE_MAX) return std::nullopt;
+
+        uint32_t x = skyline[bestIndex].x;
+        skyline.insert(skyline.begin() + bestIndex, { x, bestY + h, w });
+        //新段覆盖掉的部分从后面的段里扣除
+        for (size_t i = bestIndex + 1; i < skyline.size();) {
+            Segment& prev = skyline[i - 1];
+            Segment& seg = skyline[i];
+            if (seg.x >= prev.x + prev.width) break;
+            uint32_t shrink = prev.x + prev.width - seg.x;
+            if (shrink >= seg.width) {
+                skyline.erase(skyline.begin() + i);
+                continue;
+            }
+            seg.x += shrink;
+            seg.width -= shrink;
+            break;
+        }
+        merge();
+        usedArea += (uint64_t)w * h;
+        return std::make_pair(x, bestY);
+    }
+
+    float occupancy() const { return (float)usedArea / ((float)size * size); }
+
+private:
+    struct Segment {
+        uint32_t x, y, width;
+    };
+
+    //从第i段开始放宽w的矩形，y是它会落到的高度
+    bool fits(size_t i, uint32_t w, uint32_t h, uint32_t& y) const
+    {
+        uint32_t x = skyline[i].x;
+        if (x + w > size) return false;
+        y = 0;
+        uint32_t remaining = w;
+        for (size_t j = i; remaining > 0; ++j) {
+            if (j >= skyline.size()) return false;
+            y = std::max(y, skyline[j].y);
+            if (y + h > size) return false;
+            remaining -= std::min(remaining, skyline[j].width);
+        }
+        return true;
+    }
+
+    //高度相同的相邻段合并
+    void merge()
+    {
+        for (size_t i = 1; i < skyline.size();) {
+            if (skyline[i - 1].y == skyline[i].y) {
+                skyline[i - 1].width += skyline[i].width;
+                skyline.erase(skyline.begin() + i);
+            }
+            else ++i;
+        }
+    }
+
+    uint32_t size;
+    uint64_t usedArea = 0;
+    std::vector<Segment> skyline;
+};
+
+//mip数量：一直减半到1x1
+uint32_t MipLevelCount(uint32_t size)
+{
+    uint32_t levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+//2x2盒式滤波生成下一级mip
+std::vector<uint8_t> Downsample(const std::vector<uint8_t>& src, uint32_t srcSize)
+{
+    uint32_t dstSize = std::max(srcSize / 2, 1u);
+    std::vector<uint8_t> dst((size_t)dstSize * dstSize * 4);
+    for (uint32_t y = 0; y < dstSize; ++y) {
+        for (uint32_t x = 0; x < dstSize; ++x) {
+            uint32_t sx = std::min(x * 2, srcSize - 1), sy = std::min(y * 2, srcSize - 1);
+            uint32_t sx1 = std::min(sx + 1, srcSize - 1), sy1 = std::min(sy + 1, srcSize - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sum = src[((size_t)sy * srcSize + sx) * 4 + c] + src[((size_t)sy * srcSize + sx1) * 4 + c]
+                    + src[((size_t)sy1 * srcSize + sx) * 4 + c] + src[((size_t)sy1 * srcSize + sx1) * 4 + c];
+                dst[((size_t)y * dstSize + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+//图集构建器：add()登记图片，build()装箱并生成各页的像素和mip
+class TextureAtlasBuilder {
+public:
+    //padding：小图之间留的边（用边缘像素填充），避免双线性采样串色
+    //每降一级mip边就窄一半，所以只生成到边还剩1个texel的那一级（log2(padding)+1级），更低的级别会和相邻的小图混在一起
+    explicit TextureAtlasBuilder(uint32_t pageSize = 2048, uint32_t padding = 4)
+        : pageSize(pageSize), padding(padding) {}
+
+    //返回图片编号，build()之后用 region(id) 查位置
+    uint32_t add(AtlasImage image)
+    {
+        if (image.width + padding * 2 > pageSize || image.height + padding * 2 > pageSize)
+            throw std::runtime_error("atlas image larger than page!");
+        images.push_back(std::move(image));
+        return (uint32_t)images.size() - 1;
+    }
+
+    //先按高度从高到低排序再装箱，skyline对这种顺序最友好
+    void build(bool generateMips = true)
+    {
+        std::vector<uint32_t> order(images.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return images[a].height != images[b].height ? images[a].height > images[b].height : images[a].width > images[b].width;
+        });
+
+        regions.assign(images.size(), {});
+        pages.clear();
+        std::vector<SkylinePacker> packers;
+        for (uint32_t id : order) {
+            const AtlasImage& img = images[id];
+            uint32_t w = img.width + padding * 2, h = img.height + padding * 2;
+            std::optional<std::pair<uint32_t, uint32_t>> pos;
+            uint32_t page = 0;
+            for (; page < packers.size(); ++page) {
+                if ((pos = packers[page].pack(w, h))) break;
+            }
+            if (!pos) {
+                packers.emplace_back(pageSize);
+                pages.push_back({ pageSize, { std::vector<uint8_t>((size_t)pageSize * pageSize * 4, 0) } });
+                pos = packers.back().pack(w, h);
+            }
+            blit(pages[page].mips[0], img, pos->first + padding, pos->second + padding);
+
+            AtlasRegion& r = regions[id];
+            r.page = page;
+            r.uv[0] = (float)(pos->first + padding) / pageSize;
+            r.uv[1] = (float)(pos->second + padding) / pageSize;
+            r.uv[2] = (float)(pos->first + padding + img.width) / pageSize;
+            r.uv[3] = (float)(pos->second + padding + img.height) / pageSize;
+        }
+
+        if (generateMips) {
+            for (auto& page : pages) {
+                uint32_t levels = std::min(MipLevelCount(pageSize), MipLevelCount(padding));
+                for (uint32_t level = 1, size = pageSize; level < levels; ++level, size /= 2)
+                    page.mips.push_back(Downsample(page.mips.back(), size));
+            }
+        }
+        occupancy = 0.0f;
+        for (auto& p : packers) occupancy += p.occupancy();
+        if (!packers.empty()) occupancy /= packers.size();
+    }
+
+    const AtlasRegion& region(uint32_t id) const { return regions[id]; }
+    const std::vector<AtlasPage>& atlasPages() const { return pages; }
+    float averageOccupancy() const { return occupancy; }
+
+    //图片像素可以在上传后释放
+    void releaseSourceImages() { images.clear(); images.shrink_to_fit(); }
+
+private:
+    //把图片拷进页，并把边缘像素向外复制padding圈
+    void blit(std::vector<uint8_t>& dst, const AtlasImage& img, uint32_t x0, uint32_t y0) const
+    {
+        int pad = (int)padding;
+        for (int y = -pad; y < (int)img.height + pad; ++y) {
+            uint32_t sy = (uint32_t)std::clamp(y, 0, (int)img.height - 1);
+            for (int x = -pad; x < (int)img.width + pad; ++x) {
+                uint32_t sx = (uint32_t)std::clamp(x, 0, (int)img.width - 1);
+                const uint8_t* src = &img.pixels[((size_t)sy * img.width + sx) * 4];
+                uint8_t* d = &dst[((size_t)(y0 + y) * pageSize + (x0 + x)) * 4];
+                d[0] = src[0]; d[1] = src[1]; d[2] = src[2]; d[3] = src[3];
+            }
+        }
+    }
+
+    uint32_t pageSize;
+    uint32_t padding;
+    float occupancy = 0.0f;
+    std::vector<AtlasImage> images;
+    std::vector<AtlasRegion> regions;
+    std::vector<AtlasPage> pages;
+};
@@ -1,5 +1,9 @@
+#pragma once
+//定义 SIMPLE2D_NO_GLFW 时不依赖GLFW（只用headless的程序，比如benchmark），窗口相关的函数不编译
+#ifndef SIMPLE2D_NO_GLFW
 #define GLFW_INCLUDE_VULKAN // 自动包含 vulkan.h
 #include <GLFW/glfw3.h>
+#endif
 #include <vulkan/vulkan.hpp>
 #include <iostream>
 #include <fstream>
@@ -9,6 +13,7 @@
 #include <array>
 #include <chrono>
 #include <cstring>
+#include "Profiler.h"
 
 //vulkan调试工具
 const std::vector<const char*> validationLayers = {
@@ -82,6 +87,7 @@ createBuffer(
 }
 
 //-----------------About Vulkan----------------------
+#ifndef SIMPLE2D_NO_GLFW
 //创建窗口(初始化 GLFW，告诉它“我不打算用 OpenGL”)
 GLFWwindow* InitWindow(int w, int h, std::string winName) {
     glfwInit();
@@ -90,7 +96,8 @@ GLFWwindow* InitWindow(int w, int h, std::string winName) {
 }
 //创建 Vulkan 实例（等于：跟系统打招呼“我要用 Vulkan”）
 vk::UniqueInstance InitInstance() {
-    vk::ApplicationInfo appInfo("Lesson 3", 1, "NoEngine", 1, VK_API_VERSION_1_0);
+    PROFILE_SCOPE("InitInstance");
+    vk::ApplicationInfo appInfo("Lesson 3", 1, "NoEngine", 1, VK_API_VERSION_1_2);  // bindless贴图要用1.2的descriptor indexing
     vk::InstanceCreateInfo createInfo({}, &appInfo);
 
     //vk::InstanceCreateInfo createInfo(
@@ -116,6 +123,8 @@ vk::SurfaceKHR InitSurface(
     return c_surface;
 }
 
+#endif
+
 //创建硬件队列家族（画师家族）
 std::optional<uint32_t> InitGraphicFamily(
     const vk::PhysicalDevice& physicalDevice,
@@ -136,31 +145,58 @@ std::optional<uint32_t> InitGraphicFamily(
 //逻辑设备：软件层来控制物理设备的中间层，就像个仪表盘一样——仪表盘接受人类的命令，然后控制硬件工作
 vk::UniqueDevice InitDevice(
     const std::optional<uint32_t>& graphicsFamily,
-    const vk::PhysicalDevice& physicalDevice)
+    const vk::PhysicalDevice& physicalDevice,
+    bool enableSwapchain = true)
 {
+    PROFILE_SCOPE("InitDevice");
     float priority = 1.0f;
     vk::DeviceQueueCreateInfo queueInfo({}, graphicsFamily.value(), 1, &priority);
-    //重要！注意设备也需要扩展
-    std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    //重要！注意设备也需要扩展（headless模式不需要swapchain）
+    std::vector<const char*> deviceExtensions;
+    if (enableSwapchain) deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+    //bindless贴图数组需要的 descriptor indexing 特性（Vulkan 1.2 核心）
+    auto supported = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>()
+        .get<vk::PhysicalDeviceVulkan12Features>();
+    if (!supported.descriptorIndexing || !supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound
+        || !supported.descriptorBindingVariableDescriptorCount || !supported.descriptorBindingSampledImageUpdateAfterBind
+        || !supported.shaderSampledImageArrayNonUniformIndexing)
+        throw std::runtime_error("device does not support descriptor indexing!");
+    vk::PhysicalDeviceVulkan12Features features12;
+    features12.descriptorIndexing = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
     vk::DeviceCreateInfo deviceCreateInfo({}, queueInfo, {}, deviceExtensions);
+    deviceCreateInfo.pNext = &features12;
     return physicalDevice.createDeviceUnique(deviceCreateInfo);
 }
 
 //传送带：运送framebuffer的工具，用来做多帧缓冲
+//presentMode和imageCount由 Presenter 按策略选好；重建时把旧的swapchain作为oldSwapchain传进来
 vk::UniqueSwapchainKHR InitSwapChain(
     const vk::PhysicalDevice& physicalDevice,
     const vk::UniqueDevice& device,
     const vk::SurfaceKHR& surface,
     const vk::SurfaceCapabilitiesKHR& capabilities,
     const vk::SurfaceFormatKHR& surfaceFormat,
-    const vk::Extent2D& extent)
+    const vk::Extent2D& extent,
+    vk::PresentModeKHR presentMode,
+    uint32_t imageCount,
+    vk::SwapchainKHR oldSwapchain = {})
 {
-    auto presentModes = physicalDevice.getSurfacePresentModesKHR(surface);
+    PROFILE_SCOPE("InitSwapChain");
+    //支持的话顺带允许作为拷贝目标（脏矩形模式从静态层往里拷背景）
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) usage |= vk::ImageUsageFlagBits::eTransferDst;
     vk::SwapchainCreateInfoKHR swapchainInfo({}, surface,
-        capabilities.minImageCount, surfaceFormat.format, surfaceFormat.colorSpace,
-        extent, 1, vk::ImageUsageFlagBits::eColorAttachment,
-        vk::SharingMode::eExclusive, {}, vk::SurfaceTransformFlagBitsKHR::eIdentity,
-        vk::CompositeAlphaFlagBitsKHR::eOpaque, presentModes[0], VK_TRUE);
+        imageCount, surfaceFormat.format, surfaceFormat.colorSpace,
+        extent, 1, usage,
+        vk::SharingMode::eExclusive, {}, capabilities.currentTransform,
+        vk::CompositeAlphaFlagBitsKHR::eOpaque, presentMode, VK_TRUE, oldSwapchain);
 
     return device->createSwapchainKHRUnique(swapchainInfo);
 }
@@ -182,14 +218,21 @@ std::vector<vk::UniqueImageView> InitImageViews(
 }
 
 //RenderPass：提前规划好的绘画步骤说明书，subpass则是每一步骤。默认带一个subpass.
+//finalLayout：交给swapchain时是ePresentSrcKHR，离屏读回时是eTransferSrcOptimal
+//loadOp为eLoad时保留图片原来的内容（脏矩形模式只重画一部分），initialLayout要和录制时图片实际的布局一致
+//只有loadOp和布局不同的render pass互相兼容，pipeline和framebuffer可以混用
 vk::UniqueRenderPass InitRenderPass(
     const vk::SurfaceFormatKHR& surfaceFormat,
-    const vk::UniqueDevice& device)
+    const vk::UniqueDevice& device,
+    vk::ImageLayout finalLayout = vk::ImageLayout::ePresentSrcKHR,
+    vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eClear,
+    vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined)
 {
+    PROFILE_SCOPE("InitRenderPass");
     vk::AttachmentDescription colorAttachment({}, surfaceFormat.format, vk::SampleCountFlagBits::e1,
-        vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+        loadOp, vk::AttachmentStoreOp::eStore,
         vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-        vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+        initialLayout, finalLayout);
 
     vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
 
@@ -216,91 +259,26 @@ std::vector<vk::UniqueFramebuffer> InitFrameBuffer(
     return framebuffers;
 }
 
-//Pipeline
-vk::UniquePipeline InitPipeline(
-    const vk::Extent2D& extent,
+//Pipeline Layout：set 0 是场景资源，textureSetLayout不为空时作为set 1（bindless贴图数组）
+//pushConstants 一般由shader反射生成；pipeline本身由 PipelineManager 按状态创建和缓存
+vk::UniquePipelineLayout InitPipelineLayout(
     const vk::UniqueDevice& device,
-    const vk::UniqueRenderPass& renderPass,
-    const vk::PipelineVertexInputStateCreateInfo& vertexInput,
     const vk::UniqueDescriptorSetLayout& descriptorSetLayout,
-    std::array<vk::PipelineShaderStageCreateInfo, 2> stages,
-    vk::UniquePipelineLayout& pipelineLayout)
+    vk::DescriptorSetLayout textureSetLayout = {},
+    const std::vector<vk::PushConstantRange>& pushConstants = {})
 {
-    vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList);
-    vk::Viewport viewport(0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f);
-    vk::Rect2D scissor({ 0, 0 }, extent);
-    vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
-    vk::PipelineRasterizationStateCreateInfo rasterizer({}, false, false, vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack, vk::FrontFace::eClockwise);
-    vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
-    vk::PipelineColorBlendAttachmentState blendState(false);
-    blendState.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-        vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
-    vk::PipelineColorBlendStateCreateInfo colorBlending({}, false, vk::LogicOp::eCopy, 1, &blendState);
-
-    // 【修改】Pipeline Layout 现在包含 Descriptor Set
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, 1, &*descriptorSetLayout);
-    pipelineLayout = device->createPipelineLayoutUnique(pipelineLayoutInfo);
-
-    vk::GraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = stages.data();
-    pipelineInfo.pVertexInputState = &vertexInput;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = *pipelineLayout;
-    pipelineInfo.renderPass = *renderPass;
-    pipelineInfo.subpass = 0;
-
-    auto pipelineResult = device->createGraphicsPipelineUnique({}, pipelineInfo);
-    return std::move(pipelineResult.value);
+    PROFILE_SCOPE("InitPipelineLayout");
+    std::vector<vk::DescriptorSetLayout> setLayouts = { *descriptorSetLayout };
+    if (textureSetLayout) setLayouts.push_back(textureSetLayout);
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, setLayouts, pushConstants);
+    return device->createPipelineLayoutUnique(pipelineLayoutInfo);
 }
 
-//DescriptorSet
-std::vector<vk::UniqueDescriptorSet, std::allocator<vk::UniqueDescriptorSet>> InitDescriptorSets(
+//DescriptorSetLayout：绑定由shader反射生成（见 ShaderLibrary.h 的 MakeSetLayoutBindings），不再手写
+vk::UniqueDescriptorSetLayout InitDescriptorSetLayout(
     const vk::UniqueDevice& device,
-    vk::UniqueDescriptorSetLayout& descriptorSetLayout,
-    vk::UniqueDescriptorPool& descriptorPool
-)
-{
-    // 2. 创建 Descriptor Set Layout
-    vk::DescriptorSetLayoutBinding binding(
-        0, // binding
-        vk::DescriptorType::eUniformBuffer,
-        1,
-        vk::ShaderStageFlagBits::eFragment
-    );
-    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, 1, &binding);
-    descriptorSetLayout = device->createDescriptorSetLayoutUnique(layoutInfo);
-
-    // 3. 创建 Descriptor Pool & Set
-    vk::DescriptorPoolSize DpoolSize(vk::DescriptorType::eUniformBuffer, 1);
-    vk::DescriptorPoolCreateInfo DpoolInfo({}, 1, 1, &DpoolSize);
-    descriptorPool = device->createDescriptorPoolUnique(DpoolInfo);
-
-    vk::DescriptorSetAllocateInfo allocSetInfo(*descriptorPool, 1, &*descriptorSetLayout);
-    return device->allocateDescriptorSetsUnique(allocSetInfo);
-}
-
-//加载shader
-std::array<vk::PipelineShaderStageCreateInfo, 2> InitShader(
-    const std::string& vertPath,
-    const std::string& fragPath,
-    vk::UniqueShaderModule& vertShader,
-    vk::UniqueShaderModule& fragShader,
-    const vk::UniqueDevice& device)
+    const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
 {
-    auto vertCode = readFile(vertPath);
-    auto fragCode = readFile(fragPath);
-    vk::ShaderModuleCreateInfo vertInfo({}, vertCode.size(), reinterpret_cast<const uint32_t*>(vertCode.data()));
-    vk::ShaderModuleCreateInfo fragInfo({}, fragCode.size(), reinterpret_cast<const uint32_t*>(fragCode.data()));
-    vertShader = device->createShaderModuleUnique(vertInfo);
-    fragShader = device->createShaderModuleUnique(fragInfo);
-
-    vk::PipelineShaderStageCreateInfo vertStage({}, vk::ShaderStageFlagBits::eVertex, *vertShader, "main");
-    vk::PipelineShaderStageCreateInfo fragStage({}, vk::ShaderStageFlagBits::eFragment, *fragShader, "main");
-    return { vertStage, fragStage };//使用array而非传统数组，不然无法作形参传递
+    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, (uint32_t)bindings.size(), bindings.data());
+    return device->createDescriptorSetLayoutUnique(layoutInfo);
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include "ShaderLibrary.h"
+#include <cstddef>
+
+//-----------------编译期顶点布局----------------------
+//每个顶点/实例结构体特化一次 VertexLayout<T>，按shader里的输入名列出字段的偏移和格式；
+//编译期检查每个字段都在结构体里、互相不重叠、格式大小已知，写错偏移或格式直接编译不过
+//location不在这里写：运行时由shader反射按名字对上（MakeVertexInput），GLSL里改location不用动C++
+//格式必须写明：半精度、snorm/unorm、RGBA8这些压缩格式从shader里的类型推不出来
+
+struct VertexAttribute {
+    const char* name;   // shader里的输入变量名
+    uint32_t offset;
+    vk::Format format;
+};
+
+//特化时提供：
+//  static constexpr vk::VertexInputRate rate;
+//  static constexpr std::array<VertexAttribute, N> attributes;
+template<typename T>
+struct VertexLayout;
+
+#define VERTEX_ATTRIBUTE(Type, member, shaderName, format) VertexAttribute{ shaderName, (uint32_t)offsetof(Type, member), format }
+
+//顶点输入常用格式的字节数，不认识的返回0
+constexpr uint32_t VertexFormatSize(vk::Format format)
+{
+    switch (format) {
+    case vk::Format::eR8Unorm: case vk::Format::eR8Snorm: case vk::Format::eR8Uint: case vk::Format::eR8Sint:
+        return 1;
+    case vk::Format::eR8G8Unorm: case vk::Format::eR8G8Snorm: case vk::Format::eR8G8Uint: case vk::Format::eR8G8Sint:
+    case vk::Format::eR16Unorm: case vk::Format::eR16Snorm: case vk::Format::eR16Uint: case vk::Format::eR16Sint: case vk::Format::eR16Sfloat:
+        return 2;
+    case vk::Format::eR8G8B8A8Unorm: case vk::Format::eR8G8B8A8Snorm: case vk::Format::eR8G8B8A8Uint: case vk::Format::eR8G8B8A8Sint:
+    case vk::Format::eA2B10G10R10UnormPack32: case vk::Format::eA2B10G10R10SnormPack32:
+    case vk::Format::eR16G16Unorm: case vk::Format::eR16G16Snorm: case vk::Format::eR16G16Uint: case vk::Format::eR16G16Sint: case vk::Format::eR16G16Sfloat:
+    case vk::Format::eR32Uint: case vk::Format::eR32Sint: case vk::Format::eR32Sfloat:
+        return 4;
+    case vk::Format::eR16G16B16A16Unorm: case vk::Format::eR16G16B16A16Snorm: case vk::Format::eR16G16B16A16Uint:
+    case vk::Format::eR16G16B16A16Sint: case vk::Format::eR16G16B16A16Sfloat:
+    case vk::Format::eR32G32Uint: case vk::Format::eR32G32Sint: case vk::Format::eR32G32Sfloat:
+        return 8;
+    case vk::Format::eR32G32B32Uint: case vk::Format::eR32G32B32Sint: case vk::Format::eR32G32B32Sfloat:
+        return 12;
+    case vk::Format::eR32G32B32A32Uint: case vk::Format::eR32G32B32A32Sint: case vk::Format::eR32G32B32A32Sfloat:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+template<typename T>
+consteval bool ValidVertexLayout()
+{
+    const auto& attributes = VertexLayout<T>::attributes;
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        uint32_t size = VertexFormatSize(attributes[i].format);
+        if (size == 0 || attributes[i].offset + size > sizeof(T)) return false;
+        for (size_t j = 0; j < i; ++j) {
+            uint32_t otherSize = VertexFormatSize(attributes[j].format);
+            if (attributes[i].offset < attributes[j].offset + otherSize && attributes[j].offset < attributes[i].offset + size) return false;
+        }
+    }
+    return true;
+}
+
+//这个结构体作为第binding个顶点缓冲
+template<typename T>
+VertexStream MakeVertexStream(uint32_t binding)
+{
+    static_assert(ValidVertexLayout<T>(), "VertexLayout<T>: attribute outside the struct, overlapping, or unknown format");
+    return { binding, (uint32_t)sizeof(T), VertexLayout<T>::rate };
+}
+
+//把结构体的字段追加进 MakeVertexInput 用的字段表
+template<typename T>
+void AppendVertexFields(std::vector<VertexField>& fields, uint32_t binding)
+{
+    static_assert(ValidVertexLayout<T>(), "VertexLayout<T>: attribute outside the struct, overlapping, or unknown format");
+    for (const VertexAttribute& a : VertexLayout<T>::attributes) fields.push_back({ a.name, binding, a.offset, a.format });
+}
@@ -1,36 +1,100 @@
 #include "Tools.h" // memcpy
+#include "FrameSync.h"
+#include "Scene.h"
+#include "Presenter.h"
+#include "PostProcess.h"
+#include <string>
 
 const int WIDTH = 800;
 const int HEIGHT = 800;
-const int INSTANCE_COUNT = 5;  // 【修改】改为单个正方形
-
-// 顶点数据结构
-struct Vertex {
-    float pos[2];
-    float color[3];
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;  // 【新增】默认同时在飞的帧数，可用 --frames-in-flight N 修改
+
+// 【新增】命令行参数
+struct Options {
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;   // --frames-in-flight N
+    bool headless = false;                                // --headless
+    uint64_t frameCount = 60;                             // --frames N（headless模式渲染多少帧）
+    std::string outDir;                                   // --out DIR（headless模式输出目录，不填则不写文件）
+    std::string outFormat = "ppm";                        // --format ppm|raw
+    uint32_t instanceCount = 0;                           // --instances N（0表示使用默认的静态5个实例）
+    float worldSize = 1.0f;                               // --world S（精灵铺满[-S,S]，大于1时大部分在屏幕外）
+    bool gpuCull = true;                                  // --no-gpu-cull 关闭GPU剔除，退回直接drawIndexed
+    uint32_t textureCount = 0;                            // --textures N（生成N张不同的精灵图装进图集，0表示纯色）
+    std::string pipelineCachePath = "pipeline_cache.bin"; // --pipeline-cache PATH（空字符串表示不读写磁盘缓存）
+    uint32_t recordThreads = 0;                           // --record-threads N（包括主线程共N个线程并行录制，0表示单线程）
+    uint32_t maxBatch = UINT32_MAX;                       // --max-batch N（每次draw最多N个实例，用来制造大量draw）
+    PresentPolicy presentPolicy = PresentPolicy::Balanced; // --present low-latency|balanced|power
+    std::string profilePath;                              // --profile PATH（记录CPU/GPU时间线，退出时写成Chrome trace JSON）
+    bool simulate = false;                                // --simulate（--instances 个精灵由CPU模拟运动，SIMD内核直接写实例缓冲）
+    bool shapes = false;                                  // --shapes（在精灵上面画一块SDF图形的图表面板）
+    bool pick = false;                                    // --pick（窗口模式，配合 --simulate：左键点击拾取鼠标下的精灵；打开 --grid）
+    bool grid = false;                                    // --grid（配合 --simulate：每帧写实例缓冲时同步空间索引，只上传屏幕里的精灵）
+    bool dashboard = false;                               // --dashboard（窗口模式：静态精灵层缓存 + 图表按脏矩形增量重画，没变化时不画）
+    bool bloom = false;                                   // --bloom（窗口模式：经渲染图做泛光后合成，B键开关；不用 --record-threads）
 };
 
-// 【新增】实例数据：存储每个实例的偏移位置
-struct InstanceData {
-    float offset[2];
-};
+Options ParseOptions(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--frames-in-flight" && i + 1 < argc) opt.framesInFlight = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--headless") opt.headless = true;
+        else if (arg == "--frames" && i + 1 < argc) opt.frameCount = std::stoull(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) opt.outDir = argv[++i];
+        else if (arg == "--format" && i + 1 < argc) opt.outFormat = argv[++i];
+        else if (arg == "--instances" && i + 1 < argc) opt.instanceCount = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--world" && i + 1 < argc) opt.worldSize = std::stof(argv[++i]);
+        else if (arg == "--no-gpu-cull") opt.gpuCull = false;
+        else if (arg == "--textures" && i + 1 < argc) opt.textureCount = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--pipeline-cache" && i + 1 < argc) opt.pipelineCachePath = argv[++i];
+        else if (arg == "--record-threads" && i + 1 < argc) opt.recordThreads = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--max-batch" && i + 1 < argc) opt.maxBatch = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--present" && i + 1 < argc) opt.presentPolicy = ParsePresentPolicy(argv[++i]);
+        else if (arg == "--profile" && i + 1 < argc) opt.profilePath = argv[++i];
+        else if (arg == "--simulate") opt.simulate = true;
+        else if (arg == "--shapes") opt.shapes = true;
+        else if (arg == "--pick") opt.pick = opt.grid = true;
+        else if (arg == "--grid") opt.grid = true;
+        else if (arg == "--dashboard") opt.dashboard = true;
+        else if (arg == "--bloom") opt.bloom = true;
+        else throw std::runtime_error("unknown argument: " + arg);
+    }
+    if (opt.pick && !opt.simulate) throw std::runtime_error("--pick requires --simulate");
+    if (opt.grid && !opt.simulate) throw std::runtime_error("--grid requires --simulate");
+    if (opt.dashboard && opt.headless) throw std::runtime_error("--dashboard is a windowed mode");
+    if (opt.bloom && (opt.headless || opt.dashboard)) throw std::runtime_error("--bloom is only supported in the default windowed mode");
+    return opt;
+}
 
-// 正方形顶点和索引数据
-const std::vector<Vertex> vertices = {
-    {{-0.1f, -0.1f}, {1.0f, 0.0f, 0.0f}}, // 左下
-    {{0.1f, -0.1f}, {1.0f, 0.0f, 0.0f}},  // 右下
-    {{0.1f, 0.1f}, {1.0f, 0.0f, 0.0f}},   // 右上
-    {{-0.1f, 0.1f}, {1.0f, 0.0f, 0.0f}}   // 左上
-};
-const std::vector<uint16_t> indices = { 0, 1, 2, 2, 3, 0 };
+// 【新增】鼠标位置换算到NDC（Vulkan的NDC里y向下，和窗口坐标同向），在空间索引里拾取精灵
+//索引在每帧写实例缓冲时已经同步好了
+void PickSprite(GLFWwindow* window, const SpatialGrid& grid)
+{
+    double cursorX, cursorY;
+    int width, height;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &width, &height);
+    if (width == 0 || height == 0) return;
+    float x = (float)(cursorX / width * 2.0 - 1.0), y = (float)(cursorY / height * 2.0 - 1.0);
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t hit = grid.pick(x, y);
+    uint32_t nearest = hit == SpatialGrid::None ? grid.nearest(x, y) : hit;
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "[pick] (" << x << ", " << y << "): ";
+    if (hit != SpatialGrid::None) std::cout << "sprite " << hit;
+    else if (nearest != SpatialGrid::None) std::cout << "nothing, nearest sprite " << nearest;
+    else std::cout << "nothing";
+    std::cout << ", query " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+}
 
-// 【新增】实例数据数组
-const std::vector<InstanceData> instanceData = {
-    {{-0.4f, -0.4f}}, {{0.4f, -0.4f}}, {{0.0f, 0.4f}},
-    {{-0.2f, 0.0f}}, {{0.2f, 0.0f}}
-};
+//窗口模式
+int RunWindowed(const Options& opt)
+{
+    uint32_t framesInFlight = opt.framesInFlight;
 
-int main() {
     //==============Init Vulkan===================
     // 初始化 GLFW
     GLFWwindow* window = InitWindow(WIDTH, HEIGHT, "Gamer");
@@ -53,131 +117,519 @@ int main() {
     vk::Queue graphicsQueue = device->getQueue(graphicsFamily.value(), 0);
 
     // 获取 Surface 支持信息
-    vk::SurfaceCapabilitiesKHR capabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
     vk::SurfaceFormatKHR surfaceFormat = physicalDevice.getSurfaceFormatsKHR(surface)[0];
-    vk::Extent2D extent = capabilities.currentExtent;
-
-    // 创建 Swapchain
-    vk::UniqueSwapchainKHR swapchain = InitSwapChain(physicalDevice, device, surface, capabilities, surfaceFormat, extent);
-
-    // 获取 Swapchain 图片 & ImageViews
-    std::vector<vk::UniqueImageView> imageViews = InitImageViews(device, swapchain, surfaceFormat);
 
     // 创建 RenderPass
     vk::UniqueRenderPass renderPass = InitRenderPass(surfaceFormat, device);
 
-    // 创建 Framebuffers
-    std::vector<vk::UniqueFramebuffer> framebuffers = InitFrameBuffer(imageViews, renderPass, extent, device);
-
-    //Uniform缓冲
-    auto [uniformBuffer, uniformBufferMemory] = createBuffer(device, physicalDevice, sizeof(float) * 4, vk::BufferUsageFlagBits::eUniformBuffer);
-    
-    //顶点缓冲
-    auto [vertexBuffer, vertexBufferMemory] = createBuffer(device,physicalDevice,sizeof(vertices[0]) * vertices.size(),vk::BufferUsageFlagBits::eVertexBuffer, vertices.data());
-
-    // 索引缓冲
-    auto [indexBuffer, indexBufferMemory] = createBuffer(device, physicalDevice, sizeof(indices[0]) * indices.size(), vk::BufferUsageFlagBits::eIndexBuffer, indices.data());
-    
-    // 【新增】创建实例缓冲
-    auto [instanceBuffer, instanceBufferMemory] = createBuffer(device, physicalDevice,
-        sizeof(instanceData[0]) * instanceData.size(),
-        vk::BufferUsageFlagBits::eVertexBuffer,
-        instanceData.data());
-
-    // 【修改】顶点绑定描述：添加实例数据绑定
-    std::array<vk::VertexInputBindingDescription, 2> bindingDesc = {
-        vk::VertexInputBindingDescription(0, sizeof(Vertex), vk::VertexInputRate::eVertex), // 顶点数据
-        vk::VertexInputBindingDescription(1, sizeof(InstanceData), vk::VertexInputRate::eInstance) // 实例数据
-    };
-
-    // 【修改】顶点属性描述：添加实例偏移属性
-    std::array<vk::VertexInputAttributeDescription, 3> attrDesc = {
-        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, pos)),  // 顶点位置
-        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)), // 顶点颜色
-        vk::VertexInputAttributeDescription(2, 1, vk::Format::eR32G32Sfloat, offsetof(InstanceData, offset)) // 实例偏移
-    };
+    // 【新增】每帧fence + 每帧imageAvailable；每张图片的renderFinished由Presenter按swapchain创建
+    FrameSync sync = InitFrameSync(device, framesInFlight, 0);
+    FrameStats stats;
+
+    // 【修改】Swapchain、ImageViews、Framebuffers 交给 Presenter：按策略选present mode和图片数，过期时就地重建
+    Presenter presenter(device, physicalDevice, surface, window, surfaceFormat, renderPass, opt.presentPolicy, sync);
+
+    // 【新增】内存子分配器 + staging上传器（必须比使用它们的Scene活得久）
+    GpuAllocator allocator(device, physicalDevice);
+    StagingUploader uploader(device, allocator, graphicsQueue, graphicsFamily.value());
+
+    Scene scene = InitScene(device, physicalDevice, allocator, uploader, renderPass, opt.textureCount, opt.pipelineCachePath);
+    uint32_t instanceCount = opt.instanceCount ? opt.instanceCount : (uint32_t)instanceOffsets.size();
+    InstanceRing<InstanceData> instances(device, allocator, framesInFlight, instanceCount, vk::BufferUsageFlagBits::eStorageBuffer);
+    SpriteBatch batch;
+    batch.setMaxBatchSize(opt.maxBatch);
+    // 【新增】GPU剔除（单位正方形半边长0.1）
+    std::unique_ptr<GpuCuller> culler;
+    if (opt.gpuCull)
+        culler = std::make_unique<GpuCuller>(device, physicalDevice, allocator, framesInFlight, *scene.shaders, "Shader/cull.comp", (uint32_t)indices.size(), std::array<float, 2>{ 0.1f, 0.1f },
+            scene.pipelines->pipelineCache());
+    CullStats cullStats;
+    // 【新增】多线程录制：任务系统 + 每帧每线程的command pool
+    //        精灵模拟也用这个任务系统；只开模拟时按CPU核数开线程
+    std::unique_ptr<JobSystem> jobs;
+    std::unique_ptr<ParallelRecorder> recorder;
+    if (opt.recordThreads > 0 || opt.simulate)
+        jobs = std::make_unique<JobSystem>(opt.recordThreads > 0 ? opt.recordThreads - 1 : std::max(2u, std::thread::hardware_concurrency()) - 1);
+    if (opt.recordThreads > 0)
+        recorder = std::make_unique<ParallelRecorder>(device, graphicsFamily.value(), framesInFlight, *jobs);
+    // 【新增】CPU模拟的运动精灵（SoA + SIMD）
+    SpriteSimulation simulation(opt.worldSize);
+    if (opt.simulate) SpawnRandomSprites(simulation, instanceCount, scene.spriteTextures);
+    // 【新增】SDF图形（图表、UI），每帧重新生成写进自己的环形缓冲
+    ShapeBatch shapes;
+    InstanceRing<ShapeInstance> shapeInstances(device, allocator, framesInFlight, 256);
+    // 【新增】--grid：模拟精灵包围盒的空间索引，每帧写实例缓冲时同步，只上传屏幕里的精灵；--pick 用它拾取
+    SpatialGrid grid(SPRITE_GRID_CELL);
+    bool mouseWasDown = false;
+    RecordStats recordStats;
+    // 【新增】GPU时间戳（每帧的结果framesInFlight帧之后取回）
+    GpuProfiler gpuProfiler(device, physicalDevice, graphicsFamily.value(), framesInFlight);
+    // 【新增】--bloom：场景先画进渲染图的临时附件，泛光之后合成到swapchain图片
+    std::unique_ptr<RenderGraph> graph;
+    std::unique_ptr<PostProcess> post;
+    RGTexture backbuffer = 0;
+    uint32_t graphGeneration = UINT32_MAX;
+    bool bloomOn = true;
+    bool bloomKeyWasDown = false;
+    if (opt.bloom) {
+        graph = std::make_unique<RenderGraph>(device, allocator);
+        post = std::make_unique<PostProcess>(device, physicalDevice, renderPass, *scene.shaders, opt.pipelineCachePath);
+    }
+    PrintAllocatorStats(allocator);
+    auto startTime = std::chrono::steady_clock::now();
+    float lastTime = 0.0f;
 
-    vk::PipelineVertexInputStateCreateInfo vertexInput({}, bindingDesc, attrDesc);
-
-    //==================================================
-    vk::UniqueDescriptorSetLayout descriptorSetLayout;
-    vk::UniqueDescriptorPool descriptorPool;
-    std::vector<vk::UniqueDescriptorSet, std::allocator<vk::UniqueDescriptorSet>> descriptorSets = InitDescriptorSets(device, descriptorSetLayout, descriptorPool);
-
-    // 4. 绑定 Uniform Buffer 到 Descriptor Set
-    vk::DescriptorBufferInfo bufferDescInfo(*uniformBuffer, 0, sizeof(float) * 4);
-    vk::WriteDescriptorSet descriptorWrite(*descriptorSets[0], 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferDescInfo);
-    device->updateDescriptorSets(descriptorWrite, nullptr);
-    
-    //-------------------加载 Shader-----------------
-    //注意，shaderModule必须保留至pipeline创建结束
-    vk::UniqueShaderModule vertShader;
-    vk::UniqueShaderModule fragShader;
-    std::array<vk::PipelineShaderStageCreateInfo, 2> stages = InitShader("Shader/test.vert.spv", "Shader/test.frag.spv", vertShader, fragShader, device);
-
-    // Pipeline 相关设置
-    vk::UniquePipelineLayout pipelineLayout;//将要引用传递进InitPipeline
-    vk::UniquePipeline pipeline = InitPipeline(extent, device, renderPass, vertexInput, descriptorSetLayout, stages, pipelineLayout);
-
-    // 创建 command pool 和 command buffer
-    vk::CommandPoolCreateInfo poolInfo({}, graphicsFamily.value());
+    // 【修改】command buffer 改为每帧一个，每帧重新录制（不再按framebuffer预先录制）
+    vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsFamily.value());
     auto commandPool = device->createCommandPoolUnique(poolInfo);
     std::vector<vk::UniqueCommandBuffer> commandBuffers =
-        device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, (uint32_t)framebuffers.size() });
-
-    //提前录制commandbuffer阶段
-    for (size_t i = 0; i < commandBuffers.size(); ++i) {
-        auto& cmd = commandBuffers[i];
-        cmd->begin({ vk::CommandBufferUsageFlagBits::eSimultaneousUse });
-        vk::ClearValue clearColor(std::array<float, 4>{0.1f, 0.1f, 0.1f, 1.0f});
-        vk::RenderPassBeginInfo rpBegin(*renderPass, *framebuffers[i], { {0,0}, extent }, clearColor);
-        cmd->beginRenderPass(rpBegin, vk::SubpassContents::eInline);
-        cmd->bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
-        cmd->bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics,
-            *pipelineLayout,
-            0, 1, &*descriptorSets[0],
-            0, nullptr
-        );
-        // 绘制命令改为使用索引绘制
-        cmd->bindVertexBuffers(0, { *vertexBuffer, *instanceBuffer }, { 0, 0 });
-        cmd->bindIndexBuffer(*indexBuffer, 0, vk::IndexType::eUint16);
-        cmd->drawIndexed(static_cast<uint32_t>(indices.size()), INSTANCE_COUNT, 0, 0, 0);
-        cmd->draw(3, INSTANCE_COUNT, 0, 0);
-        cmd->endRenderPass();
-        cmd->end();
-    }
+        device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, framesInFlight });
 
     // 帧循环
-    vk::SemaphoreCreateInfo semInfo;
-    auto imageAvailable = device->createSemaphoreUnique(semInfo);
-    auto renderFinished = device->createSemaphoreUnique(semInfo);
-
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_SCOPE("frame");
         glfwPollEvents();
 
-        uint32_t imageIndex = device->acquireNextImageKHR(*swapchain, UINT64_MAX, *imageAvailable).value;
-        auto waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        // 只等待"这套每帧资源"上一次的提交，而不是等整个设备空闲
+        double waitMs = 0.0;
+        {
+            PROFILE_SCOPE("WaitForFrame");
+            waitMs = WaitForFrame(device, sync);
+        }
+        uint32_t frame = sync.currentFrame;
+        if (culler) cullStats = culler->readStats(frame);  // 这一帧上一轮的剔除计数
+
+        // 【修改】swapchain过期（窗口大小变化等）时Presenter已经重建好，跳过这一帧
+        std::optional<uint32_t> acquired = presenter.acquire();
+        if (!acquired) continue;
+        uint32_t imageIndex = *acquired;
+        waitMs += WaitForImage(device, sync, imageIndex);
+        device->resetFences(*sync.inFlightFences[frame]);
+
+        // 本帧的fence已经等过，这一段实例内存GPU不会再读，可以直接覆盖
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+        float dt = std::min(time - lastTime, 0.1f);    // 卡顿（拖动窗口等）之后不要一步跳太远
+        lastTime = time;
+        {
+            PROFILE_SCOPE("BuildSprites");
+            if (opt.simulate) {
+                BuildSimulatedSprites(batch, simulation, instances, frame, dt, jobs.get(), opt.grid ? &grid : nullptr);
+            }
+            else {
+                batch.begin();
+                BuildSprites(batch, instanceCount, time, opt.worldSize, scene.spriteTextures);
+                batch.end(instances.begin(frame, batch.size()));
+            }
+            if (opt.shapes) {
+                const vk::Extent2D& shapeExtent = presenter.currentExtent();
+                shapes.begin(ShapeAspect(shapeExtent.width, shapeExtent.height));
+                BuildShapes(shapes, time);
+                shapes.end(shapeInstances.begin(frame, shapes.size()));
+            }
+        }
+        if (opt.pick) {
+            bool mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+            if (mouseDown && !mouseWasDown) PickSprite(window, grid);
+            mouseWasDown = mouseDown;
+        }
+        if (graph) {
+            //B键开关泛光：pass照常声明，合成不读泛光时亮部和模糊的pass被剔除，它们的内存也不分配
+            bool bloomKeyDown = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+            if (bloomKeyDown && !bloomKeyWasDown) {
+                bloomOn = !bloomOn;
+                graphGeneration = UINT32_MAX;
+            }
+            bloomKeyWasDown = bloomKeyDown;
+            //swapchain重建过（大小和图片都可能变了）：等GPU空闲，重新声明并compile
+            if (graphGeneration != presenter.generation()) {
+                graphGeneration = presenter.generation();
+                device->waitIdle();
+                const vk::Extent2D& extent = presenter.currentExtent();
+                graph->reset();
+                backbuffer = graph->importTexture("backbuffer", extent, surfaceFormat.format,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+                RGTexture sceneColor = graph->createTexture("scene color", extent, surfaceFormat.format);
+                AddScenePass(*graph, sceneColor, scene, instances, batch, opt.shapes ? &shapeInstances : nullptr, culler.get(), &gpuProfiler);
+                post->addPasses(*graph, sceneColor, backbuffer, bloomOn);
+                graph->compile();
+                post->bind(*graph);
+                PrintRenderGraph(*graph);
+            }
+            graph->setImported(backbuffer, presenter.image(imageIndex), presenter.view(imageIndex));
+        }
+
+        auto& cmd = commandBuffers[frame];
+        cmd->reset();
+        if (graph)
+            recordStats = RecordGraphFrame(*cmd, *graph, instances, batch, culler.get(), &gpuProfiler, frame);
+        else
+            recordStats = RecordCommandBuffer(*cmd, renderPass, presenter.framebuffer(imageIndex), presenter.currentExtent(), scene, instances, batch,
+                opt.shapes ? &shapeInstances : nullptr, culler.get(), recorder.get(), &gpuProfiler, frame);
 
-        std::array<vk::Semaphore, 1> waitSemaphores = { *imageAvailable };
+        auto waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        std::array<vk::Semaphore, 1> waitSemaphores = { *sync.imageAvailable[frame] };
         std::array<vk::PipelineStageFlags, 1> waitStages = { waitStage };
-        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *commandBuffers[imageIndex] };
+        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *cmd };
+        std::array<vk::Semaphore, 1> signalSemaphores = { *sync.renderFinished[imageIndex] };
 
         vk::SubmitInfo submitInfo = {};
         submitInfo.setWaitSemaphores(waitSemaphores)
             .setWaitDstStageMask(waitStages)
-            .setCommandBuffers(commandBuffersToSubmit);
-        graphicsQueue.submit(submitInfo, nullptr);
+            .setCommandBuffers(commandBuffersToSubmit)
+            .setSignalSemaphores(signalSemaphores);
+        {
+            PROFILE_SCOPE("submit");
+            graphicsQueue.submit(submitInfo, *sync.inFlightFences[frame]);
+        }
+        gpuProfiler.submitted(frame);
+
+        presenter.present(graphicsQueue, imageIndex);
+
+        AdvanceFrame(sync);
+        RecordFrameStats(stats, waitMs, framesInFlight);
+        GetProfiler().endFrame(stats.lastFrameMs);
+        if (stats.accumFrames == 0) {
+            PrintBatchStats(batch.stats(), culler ? &cullStats : nullptr, recordStats);
+            presenter.report();
+            GetProfiler().report();
+            gpuProfiler.report();
+            // 【新增】shader热重载：每秒检查一次源码，改过的重新编译，用到它的pipeline在后台重建
+            auto changed = scene.shaders->poll();
+            if (!changed.empty()) {
+                device->waitIdle();
+                scene.pipelines->reload(changed);
+                if (post) post->reload(changed);
+            }
+        }
+    }
+
+    device->waitIdle();
+    if (!opt.profilePath.empty()) GetProfiler().writeChromeTrace(opt.profilePath);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
+
+// 【新增】仪表盘模式（--dashboard）：大部分内容不变、一直开着的界面
+//精灵是静态层，只在窗口大小变化时画一次到离屏图片；图表（SDF图形）每秒更新一次数据，
+//变了的图形把新旧包围盒标成脏矩形，每帧只把这些区域从静态层拷回来、在scissor里重画图形
+//什么都没变时不acquire也不present，阻塞在 glfwWaitEventsTimeout 里等事件或者下一次数据更新
+int RunDashboard(const Options& opt)
+{
+    uint32_t framesInFlight = opt.framesInFlight;
 
-        vk::PresentInfoKHR presentInfo(1, &*renderFinished, 1, &*swapchain, &imageIndex);
-        graphicsQueue.presentKHR(presentInfo);
+    GLFWwindow* window = InitWindow(WIDTH, HEIGHT, "Gamer");
+    vk::UniqueInstance instance = InitInstance();
+    vk::SurfaceKHR surface = InitSurface(instance, window);
+    vk::PhysicalDevice physicalDevice = instance->enumeratePhysicalDevices()[0];
+    std::optional<uint32_t> graphicsFamily = InitGraphicFamily(physicalDevice, surface);
+    vk::UniqueDevice device = InitDevice(graphicsFamily, physicalDevice);
+    vk::Queue graphicsQueue = device->getQueue(graphicsFamily.value(), 0);
+    vk::SurfaceFormatKHR surfaceFormat = physicalDevice.getSurfaceFormatsKHR(surface)[0];
 
+    //静态层要拷进swapchain图片
+    if (!(physicalDevice.getSurfaceCapabilitiesKHR(surface).supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst))
+        throw std::runtime_error("--dashboard requires swapchain images usable as transfer destination");
+
+    // 静态层画完留在传输源布局；swapchain图片保留上次的内容，拷贝之后从颜色附件布局接着画
+    //两个render pass兼容（只有布局和loadOp不同），pipeline用哪个创建都行
+    vk::UniqueRenderPass layerPass = InitRenderPass(surfaceFormat, device, vk::ImageLayout::eTransferSrcOptimal);
+    vk::UniqueRenderPass loadPass = InitRenderPass(surfaceFormat, device, vk::ImageLayout::ePresentSrcKHR,
+        vk::AttachmentLoadOp::eLoad, vk::ImageLayout::eColorAttachmentOptimal);
+
+    FrameSync sync = InitFrameSync(device, framesInFlight, 0);
+    FrameStats stats;
+    Presenter presenter(device, physicalDevice, surface, window, surfaceFormat, loadPass, opt.presentPolicy, sync);
+
+    GpuAllocator allocator(device, physicalDevice);
+    StagingUploader uploader(device, allocator, graphicsQueue, graphicsFamily.value());
+
+    Scene scene = InitScene(device, physicalDevice, allocator, uploader, layerPass, opt.textureCount, opt.pipelineCachePath);
+    uint32_t instanceCount = opt.instanceCount ? opt.instanceCount : (uint32_t)instanceOffsets.size();
+    //静态层只在设备空闲时画，一份实例内存就够
+    InstanceRing<InstanceData> instances(device, allocator, 1, instanceCount, vk::BufferUsageFlagBits::eStorageBuffer);
+    SpriteBatch batch;
+    batch.setMaxBatchSize(opt.maxBatch);
+    ShapeBatch shapes;
+    std::vector<ShapeInstance> lastShapes;
+    InstanceRing<ShapeInstance> shapeInstances(device, allocator, framesInFlight, 256);
+    DamageTracker damage;
+    uint32_t generation = UINT32_MAX;
+    std::vector<OffscreenTarget> layer;
+    vk::Extent2D layerExtent;
+    PrintAllocatorStats(allocator);
+    auto startTime = std::chrono::steady_clock::now();
+    auto lastReport = startTime;
+
+    vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsFamily.value());
+    auto commandPool = device->createCommandPoolUnique(poolInfo);
+    std::vector<vk::UniqueCommandBuffer> commandBuffers =
+        device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, framesInFlight });
+
+    //静态层：精灵（时间固定为0）按当前大小画一次，画完等设备空闲
+    auto renderStaticLayer = [&]() {
+        PROFILE_SCOPE("RenderStaticLayer");
         device->waitIdle();
+        layerExtent = presenter.currentExtent();
+        layer = InitOffscreenTargets(device, physicalDevice, layerPass, surfaceFormat.format, layerExtent, 1);
+        batch.begin();
+        BuildSprites(batch, instanceCount, 0.0f, opt.worldSize, scene.spriteTextures);
+        batch.end(instances.begin(0, batch.size()));
+
+        auto cmd = std::move(device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, 1 })[0]);
+        RecordCommandBuffer(*cmd, layerPass, layer[0].framebuffer, layerExtent, scene, instances, batch,
+            nullptr, nullptr, nullptr, nullptr, 0);
+        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *cmd };
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.setCommandBuffers(commandBuffersToSubmit);
+        graphicsQueue.submit(submitInfo);
+        graphicsQueue.waitIdle();
+    };
+
+    while (!glfwWindowShouldClose(window)) {
+        PROFILE_SCOPE("frame");
+        glfwPollEvents();
+
+        //每秒输出一次重画了多少（空闲时也输出）
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            DamageStats d = damage.takeStats();
+            std::cout << "[damage] frames " << d.frames << " (full " << d.fullFrames << "), repainted "
+                << d.repaintedPixels * 100.0 << "% of the pixels" << std::endl;
+            lastReport = now;
+        }
+
+        //动态内容：图表的数据每秒更新一次，和上一次比较出变了的图形
+        float time = std::chrono::duration<float>(now - startTime).count();
+        float tick = std::floor(time);
+        auto buildShapes = [&] {
+            const vk::Extent2D& extent = presenter.currentExtent();
+            shapes.begin(ShapeAspect(extent.width, extent.height));
+            BuildShapes(shapes, tick);
+        };
+        buildShapes();
+        damage.diff(lastShapes, shapes.instances(), [&](const ShapeInstance& s) { return ShapeBounds(s, shapes.aspect()); });
+        lastShapes = shapes.instances();
+        if (presenter.resizePending()) damage.addAll();
+        if (!damage.pending()) {
+            //屏幕上最后present的那张已经是最新的：不画，睡到有事件或者下一次数据更新
+            PROFILE_SCOPE("idle");
+            glfwWaitEventsTimeout(std::max(tick + 1.0f - time, 0.001f));
+            continue;
+        }
+
+        double waitMs = 0.0;
+        {
+            PROFILE_SCOPE("WaitForFrame");
+            waitMs = WaitForFrame(device, sync);
+        }
+        uint32_t frame = sync.currentFrame;
+        std::optional<uint32_t> acquired = presenter.acquire();
+        if (!acquired) continue;
+        uint32_t imageIndex = *acquired;
+        waitMs += WaitForImage(device, sync, imageIndex);
+        device->resetFences(*sync.inFlightFences[frame]);
+
+        //swapchain重建过：新的一套图片内容未知，每张整张画一次；大小变了静态层也重画
+        if (presenter.generation() != generation) {
+            generation = presenter.generation();
+            const vk::Extent2D& extent = presenter.currentExtent();
+            damage.reset(presenter.imageCount(), extent.width, extent.height);
+            if (layerExtent != extent) renderStaticLayer();
+            //宽高比变了，图形按新的比例重新排（整张都要重画，不用再比较）
+            if (ShapeAspect(extent.width, extent.height) != shapes.aspect()) {
+                buildShapes();
+                lastShapes = shapes.instances();
+            }
+        }
+
+        DamageRegion region = damage.take(imageIndex);
+        shapes.end(shapeInstances.begin(frame, shapes.size()));
+        auto& cmd = commandBuffers[frame];
+        cmd->reset();
+        //图形的pipeline还没编好时这些区域里缺了图表：脏矩形已经取走了，全部重新标脏，编好之后再画一遍
+        if (!RecordDamagedFrame(*cmd, loadPass, presenter.framebuffer(imageIndex), presenter.image(imageIndex), presenter.currentExtent(), scene,
+            *layer[0].image, region, shapeInstances, frame))
+            damage.addAll();
+
+        //第一次写swapchain图片的是拷贝
+        auto waitStage = vk::PipelineStageFlagBits::eTransfer;
+        std::array<vk::Semaphore, 1> waitSemaphores = { *sync.imageAvailable[frame] };
+        std::array<vk::PipelineStageFlags, 1> waitStages = { waitStage };
+        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *cmd };
+        std::array<vk::Semaphore, 1> signalSemaphores = { *sync.renderFinished[imageIndex] };
+
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.setWaitSemaphores(waitSemaphores)
+            .setWaitDstStageMask(waitStages)
+            .setCommandBuffers(commandBuffersToSubmit)
+            .setSignalSemaphores(signalSemaphores);
+        {
+            PROFILE_SCOPE("submit");
+            graphicsQueue.submit(submitInfo, *sync.inFlightFences[frame]);
+        }
+
+        presenter.present(graphicsQueue, imageIndex);
+
+        AdvanceFrame(sync);
+        RecordFrameStats(stats, waitMs, framesInFlight);
+        GetProfiler().endFrame(stats.lastFrameMs);
     }
 
     device->waitIdle();
+    if (!opt.profilePath.empty()) GetProfiler().writeChromeTrace(opt.profilePath);
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
 }
 
+// 【新增】Headless模式：不需要显示器和GLFW，画到离屏图片上并异步读回
+int RunHeadless(const Options& opt)
+{
+    uint32_t framesInFlight = opt.framesInFlight;
+    vk::Extent2D extent(WIDTH, HEIGHT);
+    vk::SurfaceFormatKHR format(vk::Format::eR8G8B8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear);
+
+    vk::UniqueInstance instance = InitHeadlessInstance();
+    vk::PhysicalDevice physicalDevice = instance->enumeratePhysicalDevices()[0];
+    std::optional<uint32_t> graphicsFamily = InitHeadlessGraphicFamily(physicalDevice);
+    vk::UniqueDevice device = InitDevice(graphicsFamily, physicalDevice, false);
+    vk::Queue graphicsQueue = device->getQueue(graphicsFamily.value(), 0);
+
+    // 画完直接留在传输源布局，方便拷贝
+    vk::UniqueRenderPass renderPass = InitRenderPass(format, device, vk::ImageLayout::eTransferSrcOptimal);
+
+    // 每帧一张离屏画板 + 一个读回buffer：第N帧的拷贝和第N+1帧的渲染互不等待
+    std::vector<OffscreenTarget> targets = InitOffscreenTargets(device, physicalDevice, renderPass, format.format, extent, framesInFlight);
+    std::vector<ReadbackSlot> readbacks = InitReadbackRing(device, physicalDevice, extent, framesInFlight);
+
+    GpuAllocator allocator(device, physicalDevice);
+    StagingUploader uploader(device, allocator, graphicsQueue, graphicsFamily.value());
+
+    Scene scene = InitScene(device, physicalDevice, allocator, uploader, renderPass, opt.textureCount, opt.pipelineCachePath);
+    uint32_t instanceCount = opt.instanceCount ? opt.instanceCount : (uint32_t)instanceOffsets.size();
+    InstanceRing<InstanceData> instances(device, allocator, framesInFlight, instanceCount, vk::BufferUsageFlagBits::eStorageBuffer);
+    SpriteBatch batch;
+    batch.setMaxBatchSize(opt.maxBatch);
+    // 【新增】GPU剔除（单位正方形半边长0.1）
+    std::unique_ptr<GpuCuller> culler;
+    if (opt.gpuCull)
+        culler = std::make_unique<GpuCuller>(device, physicalDevice, allocator, framesInFlight, *scene.shaders, "Shader/cull.comp", (uint32_t)indices.size(), std::array<float, 2>{ 0.1f, 0.1f },
+            scene.pipelines->pipelineCache());
+    CullStats cullStats;
+    // 【新增】多线程录制：任务系统 + 每帧每线程的command pool
+    //        精灵模拟也用这个任务系统；只开模拟时按CPU核数开线程
+    std::unique_ptr<JobSystem> jobs;
+    std::unique_ptr<ParallelRecorder> recorder;
+    if (opt.recordThreads > 0 || opt.simulate)
+        jobs = std::make_unique<JobSystem>(opt.recordThreads > 0 ? opt.recordThreads - 1 : std::max(2u, std::thread::hardware_concurrency()) - 1);
+    if (opt.recordThreads > 0)
+        recorder = std::make_unique<ParallelRecorder>(device, graphicsFamily.value(), framesInFlight, *jobs);
+    // 【新增】CPU模拟的运动精灵（SoA + SIMD）
+    SpriteSimulation simulation(opt.worldSize);
+    if (opt.simulate) SpawnRandomSprites(simulation, instanceCount, scene.spriteTextures);
+    // 【新增】--grid：空间索引随模拟同步，只上传屏幕里的精灵
+    SpatialGrid grid(SPRITE_GRID_CELL);
+    // 【新增】SDF图形（图表、UI），每帧重新生成写进自己的环形缓冲
+    ShapeBatch shapes;
+    InstanceRing<ShapeInstance> shapeInstances(device, allocator, framesInFlight, 256);
+    RecordStats recordStats;
+    // 【新增】GPU时间戳（每帧的结果framesInFlight帧之后取回）
+    GpuProfiler gpuProfiler(device, physicalDevice, graphicsFamily.value(), framesInFlight);
+    PrintAllocatorStats(allocator);
+    auto startTime = std::chrono::steady_clock::now();
+
+    vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsFamily.value());
+    auto commandPool = device->createCommandPoolUnique(poolInfo);
+    std::vector<vk::UniqueCommandBuffer> commandBuffers =
+        device->allocateCommandBuffersUnique({ *commandPool, vk::CommandBufferLevel::ePrimary, framesInFlight });
+
+    FrameSync sync = InitFrameSync(device, framesInFlight, 0);
+    FrameStats stats;
+
+    // 读回的帧交给回调：写文件，或者由调用者自己处理
+    FrameCallback onFrame = [&](uint64_t frameIndex, const uint8_t* rgba, uint32_t width, uint32_t height) {
+        if (opt.outDir.empty()) return;
+        char name[32];
+        snprintf(name, sizeof(name), "frame_%05llu.%s", (unsigned long long)frameIndex, opt.outFormat == "raw" ? "raw" : "ppm");
+        std::string path = opt.outDir + "/" + name;
+        if (opt.outFormat == "raw") WriteRaw(path, rgba, width, height);
+        else WritePPM(path, rgba, width, height);
+    };
+
+    for (uint64_t frameIndex = 0; frameIndex < opt.frameCount; ++frameIndex) {
+        PROFILE_SCOPE("frame");
+        double waitMs = 0.0;
+        {
+            PROFILE_SCOPE("WaitForFrame");
+            waitMs = WaitForFrame(device, sync);
+        }
+        uint32_t frame = sync.currentFrame;
+        if (culler) cullStats = culler->readStats(frame);  // 这一帧上一轮的剔除计数
+
+        // fence已signal：这一slot里是 framesInFlight 帧之前的画面，先交出去再复用
+        DeliverReadback(readbacks[frame], extent, onFrame);
+        device->resetFences(*sync.inFlightFences[frame]);
+
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+        {
+            PROFILE_SCOPE("BuildSprites");
+            //模拟用固定步长，输出的每一帧和运行快慢无关
+            if (opt.simulate) {
+                BuildSimulatedSprites(batch, simulation, instances, frame, 1.0f / 60.0f, jobs.get(), opt.grid ? &grid : nullptr);
+            }
+            else {
+                batch.begin();
+                BuildSprites(batch, instanceCount, time, opt.worldSize, scene.spriteTextures);
+                batch.end(instances.begin(frame, batch.size()));
+            }
+            if (opt.shapes) {
+                shapes.begin(ShapeAspect(extent.width, extent.height));
+                BuildShapes(shapes, time);
+                shapes.end(shapeInstances.begin(frame, shapes.size()));
+            }
+        }
+
+        auto& cmd = commandBuffers[frame];
+        cmd->reset();
+        recordStats = RecordCommandBuffer(*cmd, renderPass, targets[frame].framebuffer, extent, scene, instances, batch,
+            opt.shapes ? &shapeInstances : nullptr, culler.get(), recorder.get(), &gpuProfiler, frame, &targets[frame], &readbacks[frame], frameIndex);
+
+        std::array<vk::CommandBuffer, 1> commandBuffersToSubmit = { *cmd };
+        vk::SubmitInfo submitInfo = {};
+        submitInfo.setCommandBuffers(commandBuffersToSubmit);
+        {
+            PROFILE_SCOPE("submit");
+            graphicsQueue.submit(submitInfo, *sync.inFlightFences[frame]);
+        }
+        gpuProfiler.submitted(frame);
+
+        AdvanceFrame(sync);
+        RecordFrameStats(stats, waitMs, framesInFlight);
+        GetProfiler().endFrame(stats.lastFrameMs);
+        if (stats.accumFrames == 0) {
+            PrintBatchStats(batch.stats(), culler ? &cullStats : nullptr, recordStats);
+            GetProfiler().report();
+            gpuProfiler.report();
+        }
+    }
+
+    // 按提交顺序取回还在路上的帧
+    for (uint32_t i = 0; i < framesInFlight; ++i) {
+        WaitForFrame(device, sync);
+        DeliverReadback(readbacks[sync.currentFrame], extent, onFrame);
+        AdvanceFrame(sync);
+    }
+
+    device->waitIdle();
+    if (!opt.profilePath.empty()) GetProfiler().writeChromeTrace(opt.profilePath);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options opt = ParseOptions(argc, argv);
+    GetProfiler().setEnabled(!opt.profilePath.empty());
+    if (opt.headless) return RunHeadless(opt);
+    if (opt.dashboard) return RunDashboard(opt);
+    return RunWindowed(opt);
+}
@@ -1,4 +1,10 @@
-"D:\Program Files (x86)\Vulkan\Bin\glslangValidator.exe" -V Shader\test.vert -o Shader\test.vert.spv
-"D:\Program Files (x86)\Vulkan\Bin\glslangValidator.exe" -V Shader\test.frag -o Shader\test.frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\test.vert -o Shader\test.vert.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\test.frag -o Shader\test.frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\shape.vert -o Shader\shape.vert.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\shape.frag -o Shader\shape.frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\fullscreen.vert -o Shader\fullscreen.vert.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\blur.frag -o Shader\blur.frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\composite.frag -o Shader\composite.frag.spv
+"%VULKAN_SDK%\Bin\glslangValidator.exe" -V Shader\cull.comp -o Shader\cull.comp.spv
 
 pause
\ No newline at end of file